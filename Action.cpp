@@ -2,17 +2,33 @@
 
 Action::Action() {}
 
-Action::Action(const std::string& name, const std::string& type)
-    : m_name(name)
-    , m_type(type)
+Action::Action(uint8_t id, bool end)
+    : m_code((id & ~END_BIT) | (end ? END_BIT : 0))
 {}
 
-const std::string& Action::name() const
+uint8_t Action::id() const
 {
-    return m_name;
+    return m_code & ~END_BIT;
 }
 
-const std::string& Action::type() const
+bool Action::start() const
 {
-    return m_type;
-}
\ No newline at end of file
+    return !(m_code & END_BIT);
+}
+
+bool Action::end() const
+{
+    return m_code & END_BIT;
+}
+
+uint8_t Action::code() const
+{
+    return m_code;
+}
+
+Action Action::fromCode(uint8_t code)
+{
+    Action action;
+    action.m_code = code;
+    return action;
+}
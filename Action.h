@@ -1,17 +1,24 @@
 #pragma once
 
-#include <string>
+#include <cstdint>
 
+// An action is a scene-defined id plus whether it starts (key press) or ends (key release).
+// Both fit in one byte: the id in the low bits, END_BIT set for END actions
 class Action
 {
-    std::string m_name = "NONE";
-    std::string m_type = "NONE";
+    uint8_t m_code = NONE;
 
 public:
+    static constexpr uint8_t NONE       = 0x7F;     // no action bound
+    static constexpr uint8_t END_BIT    = 0x80;
+
     Action();
-    Action(const std::string& name, const std::string& type);
+    Action(uint8_t id, bool end);
+
+    uint8_t id()    const;
+    bool    start() const;
+    bool    end()   const;
+    uint8_t code()  const;                      // id and END_BIT, as stored in input logs
 
-    const std::string& name() const;
-    const std::string& type() const;
-    std::string toString() const;
-};
\ No newline at end of file
+    static Action fromCode(uint8_t code);
+};
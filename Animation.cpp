@@ -2,63 +2,145 @@
 #include <iostream>
 #include <cmath>
 
-Animation::Animation()
+AnimationClip::AnimationClip()
 {
 
 }
 
-Animation::Animation(const std::string& name, const sf::Texture& t)
-    : Animation(name, t, 1, 0)
+// Frame rects are relative to region, so the frames can live anywhere in an atlas page.
+// Headless runs pass an empty texture and still get correct frame sizes from region
+AnimationClip::AnimationClip(const std::string& name, const sf::Texture& t, const sf::IntRect& region, size_t frameCount, size_t duration, size_t id)
+    : m_name        (name)
+    , m_id          (id)
+    , m_texture     (&t)
+    , m_duration    (duration)
 {
+    m_size = Vec2((float)region.width / frameCount, (float)region.height);
 
+    m_frames.clear();
+    for (size_t frame = 0; frame < frameCount; frame++)
+    {
+        m_frames.push_back(sf::IntRect(region.left + frame * m_size.x, region.top, m_size.x, m_size.y));
+    }
 }
 
-Animation::Animation(const std::string& name, const sf::Texture& t, size_t frameCount, size_t duration)
-    : m_name        (name)
-    , m_sprite      (t)
-    , m_frameCount  (frameCount)
-    , m_currentFrame(0)
-    , m_duration    (duration)
+const std::string& AnimationClip::getName() const
 {
-    m_size = Vec2((float)t.getSize().x / frameCount, (float)t.getSize().y);
-    m_sprite.setOrigin(m_size.x / 2.0f, m_size.y / 2.0f);
-    m_sprite.setTextureRect(sf::IntRect(std::floor(m_currentFrame) * m_size.x, 0, m_size.x, m_size.y));
+    return m_name;
 }
 
-void Animation::update()
+size_t AnimationClip::getId() const
 {
-    m_currentFrame++;
+    return m_id;
+}
 
-    if (m_duration != 0)
-    {   
-        float animationFrame = (m_currentFrame / m_duration) % m_frameCount;
+const sf::Texture* AnimationClip::getTexture() const
+{
+    return m_texture;
+}
 
-        float frameWidth = m_sprite.getTexture()->getSize().x / m_frameCount;
-        float frameHeight = m_sprite.getTexture()->getSize().y;
+const sf::IntRect& AnimationClip::getFrame(size_t frame) const
+{
+    return m_frames[frame];
+}
+
+size_t AnimationClip::frameCount() const
+{
+    return m_frames.size();
+}
+
+size_t AnimationClip::duration() const
+{
+    return m_duration;
+}
+
+const Vec2& AnimationClip::getSize() const
+{
+    return m_size;
+}
+
+// Played by entities whose animation was never set
+static const AnimationClip s_noClip;
+
+Animation::Animation()
+    : m_clip(&s_noClip)
+{
+
+}
 
-        auto rectangle = sf::IntRect(animationFrame * frameWidth, 0, frameWidth, frameHeight);
-        m_sprite.setTextureRect(rectangle);
+Animation::Animation(const AnimationClip& clip)
+    : m_clip(&clip)
+{
+
+}
+
+// Counts through the frames instead of dividing the frames played by the duration
+void Animation::update()
+{
+    if (m_clip->duration() == 0) {return;}
+
+    if (++m_frameTime == m_clip->duration())
+    {
+        m_frameTime = 0;
+        if (++m_frame == m_clip->frameCount()) {m_frame = 0;}
     }
 }
 
 bool Animation::hasEnded() const
 {
-    if (m_duration != 0) { return (((m_currentFrame / m_duration) % m_frameCount) == (m_frameCount - 1)); }
-    return false;
+    return m_clip->duration() != 0 && m_frame == m_clip->frameCount() - 1;
 }
 
 const std::string& Animation::getName() const
 {
-    return m_name;
+    return m_clip->getName();
+}
+
+size_t Animation::getId() const
+{
+    return m_clip->getId();
 }
 
 const Vec2& Animation::getSize() const
 {
-    return m_size;
+    return m_clip->getSize();
+}
+
+const sf::Texture* Animation::getTexture() const
+{
+    return m_clip->getTexture();
+}
+
+const sf::IntRect& Animation::getTextureRect() const
+{
+    return m_clip->getFrame(m_frame);
+}
+
+void AnimationClock::clear()
+{
+    m_clips.clear();
+    m_rects.clear();
 }
 
-sf::Sprite& Animation::getSprite()
+void AnimationClock::add(const AnimationClip& clip)
 {
-    return m_sprite;
+    if (clip.getId() >= m_rects.size()) {m_rects.resize(clip.getId() + 1, nullptr);}
+    if (m_rects[clip.getId()]) {return;}
+
+    m_clips.push_back(&clip);
+    m_rects[clip.getId()] = &clip.getFrame(0);
 }
 
+void AnimationClock::update(size_t frame)
+{
+    for (auto clip : m_clips)
+    {
+        if (clip->duration() == 0) {continue;}
+        m_rects[clip->getId()] = &clip->getFrame((frame / clip->duration()) % clip->frameCount());
+    }
+}
+
+const sf::IntRect& AnimationClock::getTextureRect(size_t clipId) const
+{
+    return *m_rects[clipId];
+}
@@ -1,26 +1,70 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <cstdint>
 #include "Vec2.h"
 #include <SFML/Graphics.hpp>
 
+// Frames of an animation, created once by Assets and shared by every entity playing it
+class AnimationClip
+{
+    std::string                 m_name = "none";    // animation name
+    size_t                      m_id = NO_ID;       // index in Assets, compared instead of m_name at runtime
+    const sf::Texture*          m_texture = nullptr;
+    std::vector<sf::IntRect>    m_frames = {sf::IntRect()}; // texture rect of each frame, left to right in the region
+    size_t                      m_duration = 0;     // game frame duration of each animation frame
+    Vec2                        m_size = {1, 1};    // size of the animation frame
+
+public:
+    static const size_t NO_ID = (size_t)-1;
+
+    AnimationClip();
+    AnimationClip(const std::string& name, const sf::Texture& t, const sf::IntRect& region, size_t frameCount, size_t duration, size_t id = NO_ID);
+
+    const std::string&  getName() const;
+    size_t              getId() const;
+    const sf::Texture*  getTexture() const;
+    const sf::IntRect&  getFrame(size_t frame) const;
+    size_t              frameCount() const;
+    size_t              duration() const;
+    const Vec2&         getSize() const;
+};
+
+// One entity's playback of a clip: the clip and how far it has played. Small enough to copy freely
 class Animation
 {
-    sf::Sprite  m_sprite;
-    size_t      m_frameCount    = 1; // total number of frames of animation
-    size_t      m_currentFrame  = 0; // current frame of animation being played
-    size_t      m_duration      = 0; // game frame duration of each animation frame
-    Vec2        m_size          = {1, 1}; //size of the animation frame
-    std::string m_name = "none";     // animation name
+    const AnimationClip*    m_clip;
+    uint32_t                m_frame = 0;        // frame of the clip being shown
+    uint32_t                m_frameTime = 0;    // game frames the current frame has been shown
 
 public:
     Animation();
-    Animation(const std::string& name, const sf::Texture& t);
-    Animation(const std::string& name, const sf::Texture& t, size_t frameCount, size_t duration);
+    Animation(const AnimationClip& clip);
 
     void update();
     bool hasEnded() const;
     const std::string& getName() const;
+    size_t getId() const;
     const Vec2& getSize() const;
-    sf::Sprite& getSprite();
-};
\ No newline at end of file
+    const sf::Texture* getTexture() const;
+    const sf::IntRect& getTextureRect() const;
+};
+
+// Frame of every clip played in step with a scene's frame counter, worked out once per clip per
+// frame. Entities playing a clip this way skip Animation::update and read the rect from here, so
+// a level full of blinking Question tiles costs one update per clip instead of one per tile
+class AnimationClock
+{
+    std::vector<const AnimationClip*>   m_clips;    // clips added, in order
+    std::vector<const sf::IntRect*>     m_rects;    // current frame, indexed by clip id
+
+public:
+    void clear();
+    void add(const AnimationClip& clip);
+
+    // Shows frame (frame / duration) % frameCount of every clip, as if each had played since frame 0
+    void update(size_t frame);
+
+    const sf::IntRect& getTextureRect(size_t clipId) const;
+};
@@ -1,9 +1,48 @@
 #include "Assets.h"
 
+TextureHandle::TextureHandle(const Assets* assets, size_t page)
+    : m_assets(assets)
+    , m_page(page)
+{
+    m_assets->retain(m_page);
+}
+
+TextureHandle::TextureHandle(const TextureHandle& other)
+    : TextureHandle()
+{
+    *this = other;
+}
+
+TextureHandle& TextureHandle::operator=(const TextureHandle& other)
+{
+    if (other.m_assets) {other.m_assets->retain(other.m_page);}
+    if (m_assets) {m_assets->release(m_page);}
+    m_assets = other.m_assets;
+    m_page = other.m_page;
+    return *this;
+}
+
+TextureHandle::~TextureHandle()
+{
+    if (m_assets) {m_assets->release(m_page);}
+}
+
 Assets::Assets() {}
 
-void Assets::loadFromFile(const std::string& path)
+Assets::~Assets()
+{
+    if (m_loader.joinable()) {m_loader.join();}
+}
+
+void Assets::loadFromFile(const std::string& path, bool headless)
 {
+    loadAsync(path, headless);
+    wait();
+}
+
+void Assets::loadAsync(const std::string& path, bool headless)
+{
+    m_headless = headless;
     std::ifstream fin(path);
     std::string temp;
 
@@ -13,70 +52,287 @@ void Assets::loadFromFile(const std::string& path)
         {
             std::string name, path;
             fin >> name >> path;
-            addTexture(name, path);
+            m_texturePaths.push_back({name, path});
         }
         else if (temp == "Animation")
         {
-            std::string name, texture;
-            size_t frames, duration;
-            fin >> name >> texture >> frames >> duration;
-            addAnimation(name, texture, frames, duration);
+            AnimationConfig config;
+            fin >> config.name >> config.texture >> config.frames >> config.duration;
+            m_animationConfigs.push_back(config);
         }
         else if (temp == "Font")
         {
-            std::cout << "font font font" << std::endl;
             std::string name, path;
             fin >> name >> path;
-            addFont(name, path);
+            m_fontPaths.push_back({name, path});
+        }
+        else if (temp == "Atlas")
+        {
+            unsigned pageSize;
+            fin >> pageSize >> m_atlasCachePath;                // Atlas page size (pixels), cache file prefix
+            m_atlas.setPageSize(pageSize);
         }
     }
+
+    // The loader only looks fonts up, so the map does not change under readers
+    for (auto& font : m_fontPaths) {m_fontMap[font.first];}
+
+    m_fileCount = m_fontPaths.size() + m_texturePaths.size();
+    m_loader = std::thread(&Assets::load, this);
 }
 
-void Assets::addTexture(const std::string& textureName, const std::string& path, bool smooth)
+// Runs on m_loader, fanning the files out over a pool of its own so it never competes with a scene's jobs
+void Assets::load()
 {
-    m_textureMap[textureName] = sf::Texture();
+    auto start = std::chrono::steady_clock::now();
+    JobSystem jobs(std::max(1u, std::thread::hardware_concurrency()) - 1);
+
+    // Fonts are small and let the menu show text while the textures load
+    std::vector<uint8_t> fontLoaded(m_fontPaths.size());
+    jobs.parallelFor(m_fontPaths.size(), 1, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            fontLoaded[i] = m_fontMap.find(m_fontPaths[i].first)->second.loadFromFile(m_fontPaths[i].second);
+            m_filesLoaded++;
+        }
+    });
 
-    if (!m_textureMap[textureName].loadFromFile(path))
+    for (size_t i = 0; i < m_fontPaths.size(); i++)
     {
-        std::cerr << "Could not load texture file: " << path << std::endl;
-        m_textureMap.erase(textureName);
+        if (fontLoaded[i]) {continue;}
+        std::cerr << "Could not load font file: " << m_fontPaths[i].second << std::endl;
+        m_fontMap.erase(m_fontPaths[i].first);
     }
-    else
+    m_fontsLoaded = true;
+
+    loadTextures(jobs);
+
+    // Animations refer to atlas regions, so they are created once all textures are packed
+    for (auto& config : m_animationConfigs)
     {
-        std::cout << "Loaded: " << textureName << std::endl;
-        m_textureMap[textureName].setSmooth(smooth);
+        addAnimation(config.name, config.texture, config.frames, config.duration);
     }
+
+    m_pages.reset(new PageState[m_atlas.pageCount()]);
+
+    std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+    std::cout << "Loaded " << m_fontMap.size() << " fonts, " << m_texturePaths.size() << " textures and "
+              << m_animations.size() << " animations in " << time.count() << " ms" << std::endl;
+    m_loaded = true;
 }
 
-void Assets::addAnimation(const std::string& animationName, const std::string& textureName, size_t frameCount, size_t duration)
+void Assets::loadTextures(JobSystem& jobs)
+{
+    // Decoding every source image is skipped entirely when an up to date atlas cache exists.
+    // Its pages are only decoded once something asks for them
+    if (!m_atlasCachePath.empty() && m_atlas.loadCacheIndex(m_atlasCachePath, m_texturePaths, !m_headless))
+    {
+        m_fileCount = m_fontPaths.size();
+        return;
+    }
+
+    // Without a GPU the images are still decoded, Animations need their size for frame rects
+    for (auto& texture : m_texturePaths) {m_atlas.addSource(texture.first, texture.second);}
+
+    std::vector<uint8_t> decoded(m_texturePaths.size());
+    jobs.parallelFor(m_texturePaths.size(), 1, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            decoded[i] = m_atlas.decodeSource(i);
+            m_filesLoaded++;
+        }
+    });
+
+    for (size_t i = 0; i < m_texturePaths.size(); i++)
+    {
+        if (!decoded[i]) {std::cerr << "Could not load texture file: " << m_texturePaths[i].second << std::endl;}
+    }
+
+    m_atlas.build(!m_headless, m_atlasCachePath);
+}
+
+void Assets::wait()
+{
+    if (m_loader.joinable()) {m_loader.join();}
+}
+
+bool Assets::isLoaded() const
+{
+    return m_loaded;
+}
+
+bool Assets::fontsLoaded() const
+{
+    return m_fontsLoaded;
+}
+
+float Assets::progress() const
 {
-    m_animationMap[animationName] = Animation(animationName, getTexture(textureName), frameCount, duration);
-    std::cout << "Added: " << animationName << std::endl;
+    if (m_loaded) {return 1;}
+    return (float)m_filesLoaded / std::max((size_t)1, m_fileCount.load());
 }
 
-void Assets::addFont(const std::string& fontName, const std::string& path)
+void Assets::updateResidency()
 {
-    m_fontMap[fontName] = sf::Font();
+    if (!m_loaded || m_headless) {return;}
 
-    if (!m_fontMap[fontName].loadFromFile(path))
+    // Upload the pages asked for. Pages nobody acquired, or evicted ones, are decoded here first
+    for (size_t page = 0; page < m_atlas.pageCount(); page++)
     {
-        std::cerr << "Could not load font file: " << path << std::endl;
-        m_fontMap.erase(fontName);
+        auto& state = m_pages[page];
+        std::lock_guard<std::mutex> lock(state.mutex);
+
+        bool requested = state.requested.exchange(false);
+        if (state.resident || state.failed) {continue;}
+        if (!requested && state.handles == 0) {continue;}
+        if (!decodePage(page)) {continue;}
+
+        m_atlas.uploadPage(page);
+        auto size = m_atlas.getPage(page).getSize();
+        state.bytes = (size_t)size.x * size.y * 4;
+        state.resident = true;
+        m_residentBytes += state.bytes;
     }
-    else
+
+    // Unload the least recently used pages without handles until the budget is met
+    while (m_residentBytes > m_budgetBytes)
     {
-        std::cout << "Loaded: " << fontName << std::endl;
+        size_t victim = m_atlas.pageCount();
+        for (size_t page = 0; page < m_atlas.pageCount(); page++)
+        {
+            auto& state = m_pages[page];
+            if (!state.resident || state.handles > 0) {continue;}
+            if (victim == m_atlas.pageCount() || state.lastUse < m_pages[victim].lastUse) {victim = page;}
+        }
+        if (victim == m_atlas.pageCount()) {break;}
+
+        // acquire may have taken a handle since the page was picked, it is then skipped next time round
+        auto& state = m_pages[victim];
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (state.handles > 0) {continue;}
+
+        m_atlas.unloadPage(victim);
+        state.resident = false;
+        m_residentBytes -= state.bytes;
+        m_evictions++;
     }
 }
 
+void Assets::setTextureBudget(size_t bytes)
+{
+    m_budgetBytes = bytes;
+}
+
+Assets::TextureStats Assets::textureStats() const
+{
+    TextureStats stats;
+    stats.hits          = m_hits;
+    stats.misses        = m_misses;
+    stats.evictions     = m_evictions;
+    stats.failedPages   = m_failedPages;
+    stats.residentBytes = m_residentBytes;
+    stats.budgetBytes   = m_budgetBytes;
+    return stats;
+}
+
+TextureHandle Assets::acquire(size_t animationId) const
+{
+    size_t page = m_animationPages[animationId];
+    touch(page, false);
+    if (m_headless) {return TextureHandle(this, page);}
+
+    // Under the lock the page is either resident with its handle keeping it so, or it is not
+    // and updateResidency can only upload it once the image decoded here is in place
+    auto& state = m_pages[page];
+    std::lock_guard<std::mutex> lock(state.mutex);
+    TextureHandle handle(this, page);
+    if (!state.resident && !state.failed) {decodePage(page);}
+    return handle;
+}
+
+bool Assets::decodePage(size_t page) const
+{
+    if (m_atlas.hasPageImage(page)) {return true;}
+    if (m_atlas.decodePage(page))   {return true;}
+
+    std::cerr << "Could not load atlas page " << page << std::endl;
+    m_pages[page].failed = true;
+    m_failedPages++;
+    return false;
+}
+
+// Pages asked for without a handle are uploaded by the next updateResidency
+void Assets::touch(size_t page, bool request) const
+{
+    if (m_headless) {return;}
+
+    auto& state = m_pages[page];
+    if (state.failed) {return;}
+
+    state.lastUse = ++m_useClock;
+    if (state.resident) {m_hits++; return;}
+
+    m_misses++;
+    if (request) {state.requested = true;}
+}
+
+void Assets::retain(size_t page) const
+{
+    m_pages[page].handles++;
+}
+
+void Assets::release(size_t page) const
+{
+    m_pages[page].handles--;
+}
+
+void Assets::addAnimation(const std::string& animationName, const std::string& textureName, size_t frameCount, size_t duration)
+{
+    // Ids are assigned in assets.txt order, redefining a name keeps its id
+    auto it = m_animationIds.find(animationName);
+    size_t id = (it != m_animationIds.end()) ? it->second : m_animations.size();
+    if (id == m_animations.size()) {m_animations.emplace_back(); m_animationIds[animationName] = id;}
+
+    auto& region = m_atlas.getRegion(textureName);
+    m_animations[id] = AnimationClip(animationName, m_atlas.getPage(region.page), region.rect, frameCount, duration, id);
+    m_animationPages.resize(m_animations.size());
+    m_animationPages[id] = region.page;
+}
+
 const sf::Texture&  Assets::getTexture(const std::string& textureName) const
 {
-    return m_textureMap.at(textureName);
+    size_t page = m_atlas.getRegion(textureName).page;
+    touch(page, true);
+    return m_atlas.getPage(page);
+}
+
+const sf::IntRect&  Assets::getTextureRect(const std::string& textureName) const
+{
+    return m_atlas.getRegion(textureName).rect;
+}
+
+const AnimationClip& Assets::getAnimation(const std::string& animationName) const
+{
+    return getAnimation(getAnimationId(animationName));
+}
+
+const AnimationClip& Assets::getAnimation(size_t animationId) const
+{
+    touch(m_animationPages[animationId], true);
+    return m_animations[animationId];
+}
+
+size_t              Assets::getAnimationId(const std::string& animationName) const
+{
+    return m_animationIds.at(animationName);
 }
 
-const Animation&    Assets::getAnimation(const std::string& animationName) const
+size_t              Assets::findAnimationId(const std::string& animationName) const
 {
-    return m_animationMap.at(animationName);
+    auto it = m_animationIds.find(animationName);
+    return (it != m_animationIds.end()) ? it->second : AnimationClip::NO_ID;
 }
 
 const sf::Font&     Assets::getFont(const std::string& fontName) const
@@ -1,28 +1,145 @@
 #pragma once
 
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 #include "Animation.h"
+#include "TextureAtlas.h"
+#include "JobSystem.h"
 #include <SFML/Graphics.hpp>
 #include <fstream>
 #include <iostream>
+#include <thread>
+#include <atomic>
 
+class Assets;
+
+// Keeps the atlas page holding an animation's frames resident on the GPU while any copy of the
+// handle is alive. Scenes hold one for every animation they may draw
+class TextureHandle
+{
+    const Assets*   m_assets = nullptr;
+    size_t          m_page = 0;
+
+public:
+    TextureHandle() {}
+    TextureHandle(const Assets* assets, size_t page);
+    TextureHandle(const TextureHandle& other);
+    TextureHandle& operator=(const TextureHandle& other);
+    ~TextureHandle();
+};
+
+// Loads everything listed in assets.txt. loadAsync returns at once and decodes fonts and images
+// on a thread pool in the background, fonts first. Nothing but fontsLoaded, isLoaded and progress
+// may be used until isLoaded() (or fontsLoaded() for getFont) returns true.
+//
+// Atlas pages only become textures once something asks for them: a TextureHandle, or getTexture
+// and getAnimation. updateResidency, on the thread owning the GL context, uploads the pages asked
+// for and unloads the least recently used pages without handles while the textures exceed the budget.
 class Assets
 {
-    std::map<std::string, sf::Texture>  m_textureMap;
-    std::map<std::string, Animation>    m_animationMap;
+public:
+    struct TextureStats
+    {
+        size_t hits = 0;            // pages asked for while resident
+        size_t misses = 0;          // pages asked for while not resident
+        size_t evictions = 0;
+        size_t failedPages = 0;     // could not be decoded, never asked for again
+        size_t residentBytes = 0;
+        size_t budgetBytes = 0;
+    };
+
+private:
+    friend class TextureHandle;
+
+    struct AnimationConfig
+    {
+        std::string name, texture;
+        size_t frames, duration;
+    };
+
+    // Residency of one atlas page, shared by the thread owning the GL context and the scenes.
+    // The page's image, resident, bytes and failed only change with mutex held, so a decision
+    // made on them stays true until the lock is released. The other fields are hints read freely
+    struct PageState
+    {
+        std::mutex              mutex;
+        std::atomic<size_t>     handles = {0};
+        std::atomic<bool>       requested = {false};    // asked for without a handle since the last updateResidency
+        std::atomic<bool>       resident = {false};
+        std::atomic<size_t>     lastUse = {0};          // m_useClock when last asked for
+        size_t                  bytes = 0;              // GPU memory while resident
+        std::atomic<bool>       failed = {false};       // the image could not be decoded, stop trying
+    };
+
+    mutable TextureAtlas                m_atlas;          // every Texture in assets.txt, packed into shared pages decoded on demand
+    std::vector<AnimationClip>          m_animations;     // indexed by animation id, entities point at them
+    std::vector<size_t>                 m_animationPages; // atlas page of each animation's texture
+    std::map<std::string, size_t>       m_animationIds;   // name -> id, only used while loading
     std::map<std::string, sf::Font>     m_fontMap;
+    bool                                m_headless = false;   // read image sizes only, no GPU textures
+    std::string                         m_atlasCachePath;     // optional, set by an Atlas line in assets.txt
+    std::vector<std::pair<std::string, std::string>> m_texturePaths;   // name, path in assets.txt order
+    std::vector<std::pair<std::string, std::string>> m_fontPaths;
+    std::vector<AnimationConfig>        m_animationConfigs;   // created once all textures are packed
+    std::thread                         m_loader;
+    std::atomic<size_t>                 m_filesLoaded = {0};
+    std::atomic<size_t>                 m_fileCount = {0};
+    std::atomic<bool>                   m_fontsLoaded = {false};
+    std::atomic<bool>                   m_loaded = {false};
+    std::unique_ptr<PageState[]>        m_pages;              // one per atlas page, created by the loader
+    mutable std::atomic<size_t>         m_useClock = {0};
+    mutable std::atomic<size_t>         m_hits = {0};
+    mutable std::atomic<size_t>         m_misses = {0};
+    std::atomic<size_t>                 m_evictions = {0};
+    mutable std::atomic<size_t>         m_failedPages = {0};
+    std::atomic<size_t>                 m_residentBytes = {0};
+    std::atomic<size_t>                 m_budgetBytes = {256 << 20};
 
-    void addTexture(const std::string& textureName, const std::string& path, bool smooth = true);
+    void load();
+    void loadTextures(JobSystem& jobs);
     void addAnimation(const std::string& animationName, const std::string& textureName, size_t frameCount, size_t duration);
-    void addFont(const std::string& fontName, const std::string& path);
+
+    bool decodePage(size_t page) const;     // m_pages[page].mutex must be held
+    void touch(size_t page, bool request) const;
+    void retain(size_t page) const;
+    void release(size_t page) const;
 
 public:
     Assets();
+    ~Assets();
+
+    // Loads everything before returning
+    void loadFromFile(const std::string& path, bool headless = false);
+
+    // Reads assets.txt and starts loading its files in the background
+    void loadAsync(const std::string& path, bool headless = false);
+
+    // Blocks until everything is loaded
+    void wait();
+
+    bool  isLoaded() const;
+    bool  fontsLoaded() const;
+    float progress() const;     // share of the files loaded, from 0 to 1
+
+    // Call every frame from the thread owning the GL context
+    void updateResidency();
+
+    // Textures beyond the budget are unloaded once nothing holds a handle to them
+    void         setTextureBudget(size_t bytes);
+    TextureStats textureStats() const;
 
-    void loadFromFile(const std::string& path);
+    // Decodes the animation's page on the calling thread if it is not resident, so it only has to be uploaded
+    TextureHandle acquire(size_t animationId) const;
 
+    // Textures are pages of the atlas, use getTextureRect for the part belonging to textureName
     const sf::Texture&  getTexture(const std::string& textureName) const;
-    const Animation&    getAnimation(const std::string& animationName) const;
+    const sf::IntRect&  getTextureRect(const std::string& textureName) const;
+    const AnimationClip& getAnimation(const std::string& animationName) const;
+    const AnimationClip& getAnimation(size_t animationId) const;
+    size_t              getAnimationId(const std::string& animationName) const;
+    size_t              findAnimationId(const std::string& animationName) const;   // AnimationClip::NO_ID if unknown
     const sf::Font&     getFont(const std::string& fontName) const;
-};
\ No newline at end of file
+};
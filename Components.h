@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include "Vec2.h"
 #include <SFML/Graphics.hpp>
 #include "Animation.h"
@@ -16,10 +17,11 @@ class CAnimation : public Component
 public:
     Animation animation;
     bool repeating;
+    bool synced = false;    // repeating and played by the scene's AnimationClock, animation is not updated
 
     CAnimation() {}
-    CAnimation(const Animation& anim, bool repeat)
-        : animation(anim), repeating(repeat)
+    CAnimation(const Animation& anim, bool repeat, bool sync = false)
+        : animation(anim), repeating(repeat), synced(repeat && sync)
     {}
 };
 
@@ -70,11 +72,13 @@ public:
 class CState : public Component
 {
 public:
-    std::string state   = "jumping";
+    enum State : uint8_t { JUMPING, STANDING, RUNNING, AIR };
+
+    State state         = JUMPING;
     float jumpDuration  = 0;
     
     CState() {}
-    CState(const std::string& s) : state(s) {}
+    CState(State s) : state(s) {}
 };
 
 class CTransform : public Component
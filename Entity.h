@@ -1,67 +1,49 @@
 #pragma once
 
-#include <tuple>
-#include <memory>
 #include <string>
 
 #include "Components.h"
 
 class EntityManager;
 
-typedef std::tuple<
-    CTransform,
-    CLifespan,
-    CInput,
-    CBoundingBox,
-    CAnimation,
-    CGravity,
-    CState
-> ComponentTuple;
-
+// Entity is a lightweight handle into the EntityManager's component arrays.
+// The slot index selects the components, the generation detects handles to recycled slots.
 class Entity
 {
     friend class EntityManager;
-    
-    const size_t        m_id    = 0;
-    const std::string   m_tag   = "Default";
-    bool                m_alive = true;
-    ComponentTuple      m_components;
 
-    Entity(const std::string& tag, const size_t id)
-        : m_tag(tag)
-        , m_id(id)
+    EntityManager*  m_manager       = nullptr;
+    size_t          m_index         = 0;
+    size_t          m_generation    = 0;
+
+    Entity(EntityManager* manager, const size_t index, const size_t generation)
+        : m_manager(manager)
+        , m_index(index)
+        , m_generation(generation)
     {}
 
 public:
-    void                destroy()           {m_alive = false;}
-    size_t              id()        const   {return m_id;}
-    bool                isActive()  const   {return m_alive;}
-    const std::string&  tag()       const   {return m_tag;}
-    
+    Entity() {}
+
+    void                destroy()           const;
+    size_t              id()        const   {return m_index;}
+    bool                isActive()  const;
+    const std::string&  tag()       const;
+    size_t              tagId()     const;
+
+    // Component access is defined in EntityManager.h once the component arrays are known
     template <typename T>
-    bool hasComponent()
-    {
-        return getComponent<T>().has;
-    }
+    bool hasComponent() const;
 
     template <typename T, typename... TArgs>
-    T& addComponent(TArgs&&... mArgs)
-    {
-        auto& component = getComponent<T>();
-        component = T(std::forward<TArgs>(mArgs)...);
-        component.has = true;
-        return component;
-    }
+    T& addComponent(TArgs&&... mArgs) const;
 
     template<typename T>
-    T& getComponent()
-    {
-        return std::get<T>(m_components);
-    }
+    T& getComponent() const;
 
     template<typename T>
-    void removeComponent()
-    {
-        getComponent<T>() = T();
-    }
-};
\ No newline at end of file
+    void removeComponent() const;
+
+    bool operator == (const Entity& rhs) const {return m_manager == rhs.m_manager && m_index == rhs.m_index && m_generation == rhs.m_generation;}
+    bool operator != (const Entity& rhs) const {return !(*this == rhs);}
+};
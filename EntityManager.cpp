@@ -2,43 +2,414 @@
 
 EntityManager::EntityManager() {}
 
+EntityManager::EntityManager(const Vec2& cellSize)
+    : m_grid(cellSize)
+    , m_visibilityGrid(cellSize * 4.0f)
+{}
+
 void EntityManager::update()
 {
     //Create new entities
     for (auto e : m_toAdd)
     {
+        auto& tag = m_tagList[m_tags[e.m_index]];
+        m_entityPos[e.m_index] = m_entities.size();
+        m_tagPos[e.m_index] = tag.entities.size();
         m_entities.push_back(e);
-        m_entityMap[e->tag()].push_back(e);
+        tag.entities.push_back(e);
+        if (!tag.isStatic)
+        {
+            m_dynamicPos[e.m_index] = m_dynamicEntities.size();
+            m_dynamicEntities.push_back(e);
+        }
+        m_added[e.m_index] = true;
+        updateSpatial(e.m_index);
     }
     m_toAdd.clear();
 
-    // Remove dead entities from EntityVec and all EntityVec's inside EntityMap
-    removeDeadEntities(m_entities);
-    for (auto& [tag, entityVec] : m_entityMap)
+    // Only the vectors holding destroyed entities are touched. Entities destroyed before
+    // they were added have just been added above, so every destroyed slot is in them
+    for (auto index : m_destroyed)
     {
-        removeDeadEntities(entityVec);
+        swapRemove(m_entities, m_entityPos, index);
+        swapRemove(m_tagList[m_tags[index]].entities, m_tagPos, index);
+        if (!m_tagList[m_tags[index]].isStatic) {swapRemove(m_dynamicEntities, m_dynamicPos, index);}
+        freeSlot(index);
     }
+    m_destroyed.clear();
 }
 
-void EntityManager::removeDeadEntities(EntityVec& vec)
+// Removes the slot from vec by moving the last entity into its position
+void EntityManager::swapRemove(EntityVec& vec, std::vector<size_t>& positions, size_t index)
 {
-    // Use std::remove_if to avoid iterator invalidation
-    auto newItr = std::remove_if(vec.begin(), vec.end(), [](std::shared_ptr<Entity> entity) {return !entity->isActive();});
-    vec.erase(newItr, vec.end());
+    size_t pos = positions[index];
+    vec[pos] = vec.back();
+    positions[vec[pos].m_index] = pos;
+    vec.pop_back();
+}
+
+size_t EntityManager::tagId(const std::string& tag)
+{
+    auto it = m_tagIds.find(tag);
+    if (it != m_tagIds.end()) {return it->second;}
+
+    m_tagList.emplace_back();
+    m_tagList.back().name = tag;
+    m_tagIds[tag] = m_tagList.size() - 1;
+    return m_tagList.size() - 1;
 }
 
-std::shared_ptr<Entity> EntityManager::addEntity(const std::string& tag)
+const std::string& EntityManager::tagName(size_t tag) const
 {
-    //Doesn't work because Entity constructor is private
-    //auto e = std::make_shared<Entity>(tag, m_totalEntities++);
-    auto e = std::shared_ptr<Entity>(new Entity(tag, m_totalEntities++));
+    return m_tagList[tag].name;
+}
+
+Entity EntityManager::addEntity(size_t tag)
+{
+    size_t index = allocateSlot(tag);
+    m_totalEntities++;
+
+    Entity e(this, index, m_generations[index]);
     m_toAdd.push_back(e);
     return e;
 }
 
+Entity EntityManager::addEntity(const std::string& tag)
+{
+    return addEntity(tagId(tag));
+}
+
+void EntityManager::reserve(size_t tag, size_t count)
+{
+    auto& pool = m_tagList[tag].pool;
+    m_tagList[tag].pooled = true;
+    pool.reserve(pool.size() + count);
+    for (size_t i = 0; i < count; i++) {pool.push_back(growSlots());}
+
+    // Every slot may be live at once
+    auto& entities = m_tagList[tag].entities;
+    entities.reserve(entities.size() + count);
+    m_entities.reserve(m_tags.size());
+    if (!m_tagList[tag].isStatic) {m_dynamicEntities.reserve(m_dynamicEntities.size() + count);}
+    m_toAdd.reserve(m_toAdd.size() + count);
+    m_destroyed.reserve(m_tags.size());
+    m_modifiedSlots.reserve(m_tags.size());
+    m_grid.reserve(m_tags.size());
+    m_visibilityGrid.reserve(m_tags.size());
+}
+
+size_t EntityManager::allocateSlot(size_t tag)
+{
+    size_t index;
+    auto& pool = m_tagList[tag].pool;
+
+    if (!pool.empty())
+    {
+        index = pool.back();
+        pool.pop_back();
+    }
+    else if (!m_freeSlots.empty())
+    {
+        index = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    }
+    else
+    {
+        index = growSlots();
+    }
+
+    m_tags[index] = tag;
+    m_alive[index] = true;
+    markModified(index);
+    return index;
+}
+
+// Grows every component array by one default (has = false) component, returns the new slot
+size_t EntityManager::growSlots()
+{
+    size_t index = m_tags.size();
+    std::apply([](auto&... vec) {(vec.emplace_back(), ...);}, m_components);
+    m_tags.push_back(0);
+    if (index < m_generations.size())   {m_generations[index]++;}  // dropped by restore(), see there
+    else                                {m_generations.push_back(0);}
+    m_alive.push_back(false);
+    m_added.push_back(false);
+    m_entityPos.push_back(0);
+    m_tagPos.push_back(0);
+    m_dynamicPos.push_back(0);
+    m_baked.push_back(false);
+    m_modified.push_back(false);
+    return index;
+}
+
+void EntityManager::freeSlot(size_t index)
+{
+    // Reset components so the next entity in this slot starts with none
+    std::apply([index](auto&... vec) {((vec[index] = typename std::decay_t<decltype(vec)>::value_type()), ...);}, m_components);
+    m_generations[index]++;
+    m_added[index] = false;
+    m_baked[index] = false;
+    m_grid.remove(index);
+    m_visibilityGrid.remove(index);
+
+    auto& tag = m_tagList[m_tags[index]];
+    if (tag.pooled) {tag.pool.push_back(index);}
+    else            {m_freeSlots.push_back(index);}
+}
+
+void EntityManager::updateSpatial(size_t index)
+{
+    // Entities join the grid together with the entity vectors in update()
+    if (!m_added[index]) {return;}
+
+    auto& transform = getComponent<CTransform>(index);
+    auto& box = getComponent<CBoundingBox>(index);
+    auto& animation = getComponent<CAnimation>(index);
+
+    if (transform.has && box.has && !m_baked[index])    {m_grid.insert(index, transform.pos, box.halfSize);}
+    else                                                {m_grid.remove(index);}
+
+    if (transform.has && animation.has)
+    {
+        Vec2 size = animation.animation.getSize();
+        Vec2 halfSize(size.x * fabsf(transform.scale.x) / 2.0f, size.y * fabsf(transform.scale.y) / 2.0f);
+        m_visibilityGrid.insert(index, transform.pos, halfSize);
+    }
+    else
+    {
+        m_visibilityGrid.remove(index);
+    }
+}
+
+void EntityManager::updateSpatial(const Entity& entity)
+{
+    markModified(entity.m_index);
+    updateSpatial(entity.m_index);
+}
+
+void EntityManager::markModified(size_t index)
+{
+    if (m_modified[index]) {return;}
+    m_modified[index] = true;
+    m_modifiedSlots.push_back(index);
+}
+
+void EntityManager::queryRegion(const Vec2& pos, const Vec2& halfSize, size_t tag, EntityVec& out)
+{
+    queryRegion(pos, halfSize, tag, out, m_queryResult);
+}
+
+void EntityManager::queryRegion(const Vec2& pos, const Vec2& halfSize, size_t tag, EntityVec& out, std::vector<size_t>& scratch) const
+{
+    out.clear();
+    scratch.clear();
+    m_grid.query(pos, halfSize, scratch);
+
+    // Static results whose slot was freed since baking are skipped, the two sets never overlap
+    size_t dynamicCount = scratch.size();
+    m_staticGrid.query(pos, halfSize, scratch);
+    auto stale = std::remove_if(scratch.begin() + dynamicCount, scratch.end(), [this](size_t index) {return !m_baked[index];});
+    scratch.erase(stale, scratch.end());
+    if (dynamicCount > 0 && dynamicCount < scratch.size()) {std::sort(scratch.begin(), scratch.end());}
+
+    for (auto index : scratch)
+    {
+        if (m_tags[index] == tag) {out.push_back(Entity(const_cast<EntityManager*>(this), index, m_generations[index]));}
+    }
+}
+
+void EntityManager::setStatic(size_t tag, bool isStatic)
+{
+    m_tagList[tag].isStatic = isStatic;
+}
+
+EntityVec& EntityManager::getDynamicEntities() {return m_dynamicEntities;}
+
+void EntityManager::excludeFromGrid(const Entity& entity)
+{
+    markModified(entity.m_index);
+    m_baked[entity.m_index] = true;
+    m_grid.remove(entity.m_index);
+}
+
+void EntityManager::bakeStatic()
+{
+    std::vector<StaticGrid::Item> items;
+    for (auto& e : m_entities)
+    {
+        size_t index = e.m_index;
+        auto& transform = getComponent<CTransform>(index);
+        auto& box = getComponent<CBoundingBox>(index);
+        if (!m_tagList[m_tags[index]].isStatic || !transform.has || !box.has || m_baked[index]) {continue;}
+
+        items.push_back({index, transform.pos, box.halfSize});
+        m_baked[index] = true;
+        m_grid.remove(index);
+    }
+
+    m_staticGrid.build(m_grid.cellSize(), items);
+}
+
+void EntityManager::queryVisible(const Vec2& pos, const Vec2& halfSize, EntityVec& out)
+{
+    out.clear();
+    m_queryResult.clear();
+    m_visibilityGrid.query(pos, halfSize, m_queryResult);
+
+    for (auto index : m_queryResult)
+    {
+        out.push_back(Entity(this, index, m_generations[index]));
+    }
+}
+
+void EntityManager::destroy(const Entity& entity)
+{
+    if (isActive(entity))
+    {
+        m_alive[entity.m_index] = false;
+        m_destroyed.push_back(entity.m_index);
+        markModified(entity.m_index);
+    }
+}
+
+bool EntityManager::isActive(const Entity& entity) const
+{
+    // Slots created after a restored snapshot no longer exist
+    return entity.m_index < m_alive.size() && m_alive[entity.m_index] && m_generations[entity.m_index] == entity.m_generation;
+}
+
+const std::string& EntityManager::tag(const Entity& entity) const
+{
+    return m_tagList[m_tags[entity.m_index]].name;
+}
+
+size_t EntityManager::tagId(const Entity& entity) const
+{
+    return m_tags[entity.m_index];
+}
+
+size_t EntityManager::totalEntities() const {return m_totalEntities;}
+
+EntityManager EntityManager::snapshot()
+{
+    for (auto index : m_modifiedSlots) {m_modified[index] = false;}
+    m_modifiedSlots.clear();
+    return *this;
+}
+
+void EntityManager::restore(const EntityManager& snapshot)
+{
+    size_t slots = snapshot.m_tags.size();
+
+    // Systems change moving entities through component references every frame, on worker threads
+    // that cannot mark them, so the snapshot's dynamic entities are copied back unconditionally
+    for (auto& e : snapshot.m_dynamicEntities) {markModified(e.m_index);}
+
+    // Copy back every slot that existed in the snapshot and was touched since. Generations only
+    // grow: a slot that was freed or reused since the snapshot gets a new one, so no handle to an
+    // entity that lived in it in between can become valid again
+    for (auto index : m_modifiedSlots)
+    {
+        if (index >= slots) {continue;}
+
+        bool changed = m_generations[index] != snapshot.m_generations[index] || m_alive[index] != snapshot.m_alive[index];
+
+        std::apply([&](auto&... vec) {((vec[index] = std::get<std::decay_t<decltype(vec)>>(snapshot.m_components)[index]), ...);}, m_components);
+        m_tags[index]        = snapshot.m_tags[index];
+        m_alive[index]       = snapshot.m_alive[index];
+        m_added[index]       = snapshot.m_added[index];
+        m_baked[index]       = snapshot.m_baked[index];
+        m_modified[index]    = false;
+        if (changed) {m_generations[index]++;}
+
+        if (m_added[index]) {updateSpatial(index);}
+        else                {m_grid.remove(index); m_visibilityGrid.remove(index);}
+    }
+    m_modifiedSlots.clear();
+
+    // Slots created after the snapshot are dropped, the arrays keep their capacity. Their
+    // generations are kept, growSlots() advances them when the slots come back
+    for (size_t index = slots; index < m_tags.size(); index++)
+    {
+        m_grid.remove(index);
+        m_visibilityGrid.remove(index);
+    }
+    std::apply([slots](auto&... vec) {(vec.resize(slots), ...);}, m_components);
+    m_tags.resize(slots);
+    m_alive.resize(slots);
+    m_added.resize(slots);
+    m_baked.resize(slots);
+    m_modified.resize(slots);
+
+    // Swap removals may have moved any entity, so positions and entity vectors are copied whole
+    m_entityPos       = snapshot.m_entityPos;
+    m_tagPos          = snapshot.m_tagPos;
+    m_dynamicPos      = snapshot.m_dynamicPos;
+    m_freeSlots       = snapshot.m_freeSlots;
+    m_destroyed       = snapshot.m_destroyed;
+    m_tagList         = snapshot.m_tagList;
+    m_tagIds          = snapshot.m_tagIds;
+    m_entities        = snapshot.m_entities;
+    m_dynamicEntities = snapshot.m_dynamicEntities;
+    m_toAdd           = snapshot.m_toAdd;
+    m_totalEntities   = snapshot.m_totalEntities;
+
+    // The copied handles carry the snapshot's generations
+    auto refresh = [this](EntityVec& entities) {for (auto& e : entities) {e.m_generation = m_generations[e.m_index];}};
+    refresh(m_entities);
+    refresh(m_dynamicEntities);
+    refresh(m_toAdd);
+    for (auto& tag : m_tagList) {refresh(tag.entities);}
+}
+
+Entity EntityManager::rebind(const Entity& entity)
+{
+    if (entity.m_manager != this || entity.m_index >= m_alive.size() || !m_alive[entity.m_index]) {return Entity();}
+    return Entity(this, entity.m_index, m_generations[entity.m_index]);
+}
+
+void EntityManager::markModified(const Entity& entity)
+{
+    markModified(entity.m_index);
+}
+
+uint64_t EntityManager::stateHash()
+{
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](const void* data, size_t size)
+    {
+        auto bytes = (const unsigned char*)data;
+        for (size_t i = 0; i < size; i++) {hash = (hash ^ bytes[i]) * 1099511628211ULL;}
+    };
+
+    for (auto& e : m_entities)
+    {
+        mix(&e.m_index, sizeof(e.m_index));
+
+        auto& transform = getComponent<CTransform>(e.m_index);
+        if (transform.has)
+        {
+            float values[9] = {transform.pos.x, transform.pos.y, transform.prevPos.x, transform.prevPos.y,
+                               transform.scale.x, transform.scale.y, transform.velocity.x, transform.velocity.y, transform.angle};
+            mix(values, sizeof(values));
+        }
+
+        auto& state = getComponent<CState>(e.m_index);
+        if (state.has)
+        {
+            mix(&state.state, sizeof(state.state));
+            mix(&state.jumpDuration, sizeof(state.jumpDuration));
+        }
+    }
+
+    return hash;
+}
+
 EntityVec& EntityManager::getEntities() {return m_entities;}
 
-EntityVec& EntityManager::getEntities(const std::string& tag) {return m_entityMap[tag];}
+EntityVec& EntityManager::getEntities(size_t tag) {return m_tagList[tag].entities;}
+
+EntityVec& EntityManager::getEntities(const std::string& tag) {return m_tagList[tagId(tag)].entities;}
 
 /*
 int main()
@@ -48,23 +419,23 @@ int main()
 
     std::cout << "Creating e1 player" << std::endl;
     auto entity1 = em.addEntity("player");
-    entity1->addComponent<CTransform>(Vec2(100, 150), Vec2(0,0), 0);
+    entity1.addComponent<CTransform>(Vec2(100, 150), Vec2(0,0), 0);
 
     std::cout << "Creating e2 player" << std::endl;
     auto entity2 = em.addEntity("player");
-    entity2->addComponent<CTransform>(Vec2(100, 200), Vec2(0,0), 0);
+    entity2.addComponent<CTransform>(Vec2(100, 200), Vec2(0,0), 0);
 
     em.update();
 
     for (auto e : em.getEntities("player"))
     {
 
-        std::cout << e->getComponent<CTransform>().pos.x << ", " << e->getComponent<CTransform>().pos.y << std::endl;
+        std::cout << e.getComponent<CTransform>().pos.x << ", " << e.getComponent<CTransform>().pos.y << std::endl;
     }
 
-    float dist = entity1->getComponent<CTransform>().pos.dist(entity2->getComponent<CTransform>().pos);
+    float dist = entity1.getComponent<CTransform>().pos.dist(entity2.getComponent<CTransform>().pos);
     std::cout << dist << std::endl;
-    
+
     return 0;
 }
-*/
\ No newline at end of file
+*/
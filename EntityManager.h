@@ -4,29 +4,236 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <tuple>
+#include <type_traits>
+#include <cstdint>
 #include <algorithm>
 #include <iostream>
 
 #include "Entity.h"
+#include "SpatialGrid.h"
+#include "StaticGrid.h"
+
+// One dense array per component type, indexed by entity slot
+typedef std::tuple<
+    std::vector<CTransform>,
+    std::vector<CLifespan>,
+    std::vector<CInput>,
+    std::vector<CBoundingBox>,
+    std::vector<CAnimation>,
+    std::vector<CGravity>,
+    std::vector<CState>
+> ComponentVectors;
+
+// Bit of a component type in ComponentVectors, for declaring what a system reads and writes
+template <typename T, size_t I = 0>
+constexpr uint32_t componentBit()
+{
+    if constexpr (std::is_same_v<std::tuple_element_t<I, ComponentVectors>, std::vector<T>>) {return 1u << I;}
+    else {return componentBit<T, I + 1>();}
+}
+
+template <typename... Ts>
+constexpr uint32_t componentMask()
+{
+    return (componentBit<Ts>() | ... | 0u);
+}
+
+// Declared by systems that query the spatial grids or move entities in them
+const uint32_t SPATIAL_GRIDS = 1u << std::tuple_size_v<ComponentVectors>;
 
 //Entity Manager
-typedef std::vector <std::shared_ptr<Entity>>   EntityVec;
-typedef std::map    <std::string, EntityVec>    EntityMap;
+typedef std::vector <Entity>                    EntityVec;
 class EntityManager
 {
-    EntityVec   m_entities;
-    EntityVec   m_toAdd;
-    EntityMap   m_entityMap;
-    size_t      m_totalEntities = 0;
+    // Tags are interned, entities refer to them by id
+    struct Tag
+    {
+        std::string             name;
+        EntityVec               entities;
+        std::vector<size_t>     pool;               // free slots kept for this tag, see reserve()
+        bool                    pooled = false;
+        bool                    isStatic = false;   // never moves, see setStatic()
+    };
+
+    ComponentVectors            m_components;
+    std::vector<size_t>         m_tags;             // tag id of the entity in each slot
+    std::vector<size_t>         m_generations;      // incremented every time a slot is recycled
+    std::vector<bool>           m_alive;
+    std::vector<bool>           m_added;            // entity has been moved out of m_toAdd
+    std::vector<size_t>         m_entityPos;        // position of each added slot in m_entities
+    std::vector<size_t>         m_tagPos;           // position of each added slot in its tag's entities
+    std::vector<size_t>         m_dynamicPos;       // position of each added dynamic slot in m_dynamicEntities
+    std::vector<bool>           m_baked;            // collision box is not in m_grid: baked into m_staticGrid or excluded
+    std::vector<size_t>         m_freeSlots;        // slots of removed entities, ready for reuse
+    std::vector<size_t>         m_destroyed;        // slots destroyed since the last update()
+    std::vector<bool>           m_modified;         // slot changed since the last snapshot()
+    std::vector<size_t>         m_modifiedSlots;    // slots with m_modified set, so restore() skips untouched ones
+    std::vector<Tag>            m_tagList;          // indexed by tag id
+    std::map<std::string, size_t> m_tagIds;
+    EntityVec                   m_entities;
+    EntityVec                   m_dynamicEntities;  // entities whose tag is not static
+    EntityVec                   m_toAdd;
+    size_t                      m_totalEntities = 0;
+    SpatialGrid                 m_grid;             // broadphase over entities with CTransform and CBoundingBox
+    StaticGrid                  m_staticGrid;       // broadphase over static entities baked by bakeStatic()
+    SpatialGrid                 m_visibilityGrid;   // coarse index of entities with CTransform and CAnimation, for culling
+    std::vector<size_t>         m_queryResult;
+
+    size_t allocateSlot(size_t tag);
+    size_t growSlots();
+    void   freeSlot(size_t index);
+    void   updateSpatial(size_t index);
+    void   markModified(size_t index);
+    void   swapRemove(EntityVec& vec, std::vector<size_t>& positions, size_t index);
 
 public:
     EntityManager();
-    
+    EntityManager(const Vec2& cellSize);
+
+    // Adds the entities created and removes the entities destroyed since the last update.
+    // Removal swaps the last entity into the gap, so entity vectors are not kept in creation order
     void update();
-    void removeDeadEntities(EntityVec& vec);
 
-    std::shared_ptr<Entity> addEntity(const std::string& tag);
+    // Returns the id of a tag, registering new tags. Resolve ids once and use them on hot paths
+    size_t tagId(const std::string& tag);
+    const std::string& tagName(size_t tag) const;
+
+    Entity addEntity(size_t tag);
+    Entity addEntity(const std::string& tag);
+
+    // Prewarms count slots, and room in the entity vectors, for entities with this tag. Slots of
+    // this tag return to its pool when freed, so spawning short-lived entities such as bullets
+    // does no heap allocation once the pool is large enough
+    void reserve(size_t tag, size_t count);
 
     EntityVec& getEntities();
+    EntityVec& getEntities(size_t tag);
     EntityVec& getEntities(const std::string& tag);
-};
\ No newline at end of file
+
+    // Entities of a static tag never move. They are left out of getDynamicEntities, and their
+    // collision boxes can be baked into a read-only broadphase
+    void setStatic(size_t tag, bool isStatic = true);
+    EntityVec& getDynamicEntities();
+
+    // Moves the collision box of every added static entity from the dynamic grid into the static
+    // grid. Call once the level has been spawned and added by update(). Static entities added
+    // later stay in the dynamic grid, baked ones are dropped from the static grid when freed
+    void bakeStatic();
+
+    // Keeps the entity out of both collision grids until its slot is freed, for entities whose
+    // collision is looked up elsewhere (such as a tilemap)
+    void excludeFromGrid(const Entity& entity);
+
+    // Direct access to a component array for systems that iterate by slot.
+    // References into these arrays are invalidated by addEntity.
+    template <typename T>
+    std::vector<T>& getComponentVector()
+    {
+        return std::get<std::vector<T>>(m_components);
+    }
+
+    template <typename T>
+    T& getComponent(size_t index)
+    {
+        return getComponentVector<T>()[index];
+    }
+
+    // Keeps the spatial grids in sync when an entity gains or loses its position, bounding box or animation
+    template <typename T>
+    void onComponentChanged(size_t index)
+    {
+        markModified(index);
+        if constexpr (std::is_same_v<T, CTransform> || std::is_same_v<T, CBoundingBox> || std::is_same_v<T, CAnimation>) {updateSpatial(index);}
+    }
+
+    // Must be called after an entity changes position or its animation changes size.
+    // Also marks the entity as modified for restore()
+    void updateSpatial(const Entity& entity);
+
+    // Fills out with the entities of the given tag whose grid cells overlap the AABB
+    void queryRegion(const Vec2& pos, const Vec2& halfSize, size_t tag, EntityVec& out);
+
+    // Same, with a caller owned scratch buffer so threads can query concurrently
+    void queryRegion(const Vec2& pos, const Vec2& halfSize, size_t tag, EntityVec& out, std::vector<size_t>& scratch) const;
+
+    // Fills out with the animated entities whose sprite may overlap the AABB, in slot order
+    void queryVisible(const Vec2& pos, const Vec2& halfSize, EntityVec& out);
+
+    void destroy(const Entity& entity);
+    bool isActive(const Entity& entity) const;
+    const std::string& tag(const Entity& entity) const;
+    size_t tagId(const Entity& entity) const;
+    size_t totalEntities() const;
+
+    // Copy of the current state to restore() later. Clears the modified set, so call it after update()
+    EntityManager snapshot();
+
+    // Returns to a snapshot() of this manager, copying back only the slots modified since it was taken.
+    // Entities added afterwards are dropped and their slots released, so slot allocation repeats exactly.
+    // Slots that were freed or reused since the snapshot come back under new generations, see rebind()
+    void restore(const EntityManager& snapshot);
+
+    // Handle to the entity now in the given handle's slot, or a default Entity if the slot is free.
+    // Handles kept from before a restore() are passed through this to be used again afterwards
+    Entity rebind(const Entity& entity);
+
+    // restore() copies back the dynamic entities and the slots changed through addComponent,
+    // removeComponent, updateSpatial and destroy. A static entity changed only through a
+    // getComponent reference must be marked with this, or restore() will not undo the change
+    void markModified(const Entity& entity);
+
+    // FNV-1a hash of every live entity's CTransform and CState, used to detect simulation divergence
+    uint64_t stateHash();
+};
+
+// Entity handle methods forward to the component arrays owned by the EntityManager
+
+inline void Entity::destroy() const
+{
+    m_manager->destroy(*this);
+}
+
+inline bool Entity::isActive() const
+{
+    return m_manager && m_manager->isActive(*this);
+}
+
+inline const std::string& Entity::tag() const
+{
+    return m_manager->tag(*this);
+}
+
+inline size_t Entity::tagId() const
+{
+    return m_manager->tagId(*this);
+}
+
+template <typename T>
+bool Entity::hasComponent() const
+{
+    return getComponent<T>().has;
+}
+
+template <typename T, typename... TArgs>
+T& Entity::addComponent(TArgs&&... mArgs) const
+{
+    auto& component = getComponent<T>();
+    component = T(std::forward<TArgs>(mArgs)...);
+    component.has = true;
+    m_manager->onComponentChanged<T>(m_index);
+    return component;
+}
+
+template<typename T>
+T& Entity::getComponent() const
+{
+    return m_manager->getComponent<T>(m_index);
+}
+
+template<typename T>
+void Entity::removeComponent() const
+{
+    getComponent<T>() = T();
+    m_manager->onComponentChanged<T>(m_index);
+}
@@ -1,18 +1,28 @@
 #include "GameEngine.h"
 
-GameEngine::GameEngine(const std::string& path)
+GameEngine::GameEngine(const std::string& path, bool headless)
+    : m_renderer(m_window, m_assets)
+    , m_headless(headless)
+    , m_jobs(std::max(1u, std::thread::hardware_concurrency()) - 1)
 {
     init(path);
 }
 
 void GameEngine::init(const std::string path)
 {
-    // Load all assets once and access from various Scenes
-    m_assets.loadFromFile(path);
+    // Load all assets once and access from various Scenes. Headless runs never touch the GPU and wait
+    // for them, windowed runs show the menu while they load in the background
+    if (m_headless) {m_assets.loadFromFile(path, true);}
+    else            {m_assets.loadAsync(path);}
 
-    // Configure main SFML window which is shared by all scenes
-    m_window.create(sf::VideoMode(1280, 720), "Mega Mario");
-    m_window.setFramerateLimit(60);
+    // Configure main SFML window which is shared by all scenes. It is drawn on the render thread,
+    // which waits for the display's refresh, while the simulation ticks at its own fixed rate.
+    // Resizing would change the window's views from the event thread, so the size is fixed
+    if (!m_headless)
+    {
+        m_window.create(sf::VideoMode(1280, 720), "Mega Mario", sf::Style::Titlebar | sf::Style::Close);
+        m_window.setVerticalSyncEnabled(true);
+    }
 
     // Load initial Scene
     changeScene("MENU", std::make_shared<Scene_Menu>(this));
@@ -20,8 +30,24 @@ void GameEngine::init(const std::string path)
 
 void GameEngine::update()
 {
-    sUserInput();
+    if (!m_headless) {sUserInput();}
     m_sceneMap.at(m_currentScene)->update();
+    if (!m_headless) {publishSnapshot();}
+}
+
+// Copy what the current scene looks like into the next snapshot for the render thread
+void GameEngine::publishSnapshot()
+{
+    auto& snapshot = m_renderer.beginSnapshot();
+    snapshot.scene = m_sceneChanges;
+    snapshot.size = Vec2(width(), height());
+    snapshot.prevViewCenter = snapshot.viewCenter = snapshot.size / 2;
+
+    auto scene = currentScene();
+    snapshot.frame = scene->currentFrame();
+    scene->sRender(snapshot);
+
+    m_renderer.publish(m_tick);
 }
 
 // Handle raw input from users only.  Input mapping and logic is handled by Scene class
@@ -36,15 +62,26 @@ void GameEngine::sUserInput()
         if (event.type == sf::Event::KeyPressed || event.type == sf::Event::KeyReleased)
         {
             // If the current scene does not have an action associated with this key, skip the event
-            if (currentScene()->getActionMap().find(event.key.code) == currentScene()->getActionMap().end()) {continue;}
+            uint8_t id = currentScene()->actionFor(event.key.code);
+            if (id == Action::NONE) {continue;}
 
             // Determine start or end action by whether it was key press or release
-            const std::string actionType = (event.type == sf::Event::KeyPressed) ? "START" : "END";
-
-            // Look up action and send action to the scene to be executed
-            currentScene()->sDoAction(Action(currentScene()->getActionMap().at(event.key.code), actionType));
+            m_inputBuffer.push_back(Action(id, event.type == sf::Event::KeyReleased));
         }
     }
+
+    dispatchInput(m_recording);
+}
+
+// Send the buffered actions to the current scene in order. A scene change takes effect for the next action
+void GameEngine::dispatchInput(bool record)
+{
+    for (auto action : m_inputBuffer)
+    {
+        if (record) {m_inputLog.record(currentScene()->currentFrame(), action);}
+        currentScene()->sDoAction(action);
+    }
+    m_inputBuffer.clear();
 }
 
 std::shared_ptr<Scene> GameEngine::currentScene()
@@ -62,8 +99,13 @@ void GameEngine::changeScene(const std::string& sceneName, std::shared_ptr<Scene
     }
     */
 
+    // Logs belong to the scene they were started in
+    stopRecording();
+    stopReplay();
+
     m_sceneMap[sceneName] = scene;
     m_currentScene = sceneName;
+    m_sceneChanges++;
 }
 
 void GameEngine::quit()
@@ -71,17 +113,51 @@ void GameEngine::quit()
     m_running = false;
 }
 
-void GameEngine::run()
+// For scenes that need every asset at once
+void GameEngine::waitForAssets()
 {
-    while (isRunning())
+    m_assets.wait();
+}
+
+// Runs until quit, or for maxFrames frames if it is not 0.
+// Windowed runs update at a fixed tick on this thread and draw on the render thread. Headless
+// runs are not frame limited, so they step the simulation as fast as the CPU allows
+void GameEngine::run(size_t maxFrames)
+{
+    sf::Clock clock;
+    size_t frames = 0;
+
+    if (!m_headless) {m_renderer.start();}
+    auto nextTick = std::chrono::steady_clock::now();
+
+    while (isRunning() && (maxFrames == 0 || frames < maxFrames))
     {
+        if (!m_headless)
+        {
+            // Catch up on a few late ticks, but drop the rest instead of spiralling behind
+            std::this_thread::sleep_until(nextTick);
+            nextTick = std::max<std::chrono::steady_clock::time_point>(nextTick + m_tick, std::chrono::steady_clock::now() - 4 * m_tick);
+        }
+
         update();
+        frames++;
+    }
+
+    m_renderer.stop();
+    stopRecording();
+    stopReplay();
+
+    if (m_headless)
+    {
+        float seconds = clock.getElapsedTime().asSeconds();
+        std::cout << "Simulated " << frames * m_simulationSpeed << " frames in " << seconds << "s ("
+                  << (frames * m_simulationSpeed) / seconds << " frames/s)" << std::endl;
     }
 }
 
-sf::RenderWindow& GameEngine::window()
+const Renderer& GameEngine::renderer() const
 {
-    return m_window;
+    return m_renderer;
 }
 
 const Assets& GameEngine::assets() const
@@ -91,5 +167,148 @@ const Assets& GameEngine::assets() const
 
 bool GameEngine::isRunning()
 {
-    return m_running & m_window.isOpen();
+    return m_running & (m_headless || m_window.isOpen());
+}
+
+bool GameEngine::isHeadless() const
+{
+    return m_headless;
+}
+
+size_t GameEngine::width() const
+{
+    return m_headless ? m_headlessSize.x : m_window.getSize().x;
+}
+
+size_t GameEngine::height() const
+{
+    return m_headless ? m_headlessSize.y : m_window.getSize().y;
+}
+
+size_t GameEngine::simulationSpeed() const
+{
+    return m_simulationSpeed;
 }
+
+void GameEngine::setSimulationSpeed(size_t speed)
+{
+    m_simulationSpeed = std::max((size_t)1, speed);
+}
+
+
+float GameEngine::cullMargin() const
+{
+    return m_cullMargin;
+}
+
+void GameEngine::setCullMargin(float margin)
+{
+    m_cullMargin = std::max(0.0f, margin);
+}
+
+const std::string& GameEngine::profilePath() const
+{
+    return m_profilePath;
+}
+
+void GameEngine::setProfilePath(const std::string& path)
+{
+    m_profilePath = path;
+}
+
+JobSystem& GameEngine::jobs()
+{
+    return m_jobs;
+}
+
+void GameEngine::setWorkerThreads(size_t threads)
+{
+    m_jobs.setWorkerCount(threads);
+}
+
+void GameEngine::setTextureBudget(size_t bytes)
+{
+    m_assets.setTextureBudget(bytes);
+}
+
+void GameEngine::startRecording(const std::string& logPath, const std::string& levelPath)
+{
+    m_inputLog.clear(levelPath);
+    m_recordPath = logPath;
+    m_recording = true;
+}
+
+void GameEngine::stopRecording()
+{
+    if (!m_recording) {return;}
+
+    m_recording = false;
+    if (m_inputLog.save(m_recordPath))
+    {
+        std::cout << "Recorded " << m_inputLog.frames() << " frames to " << m_recordPath << std::endl;
+    }
+}
+
+void GameEngine::startReplay(InputLog log)
+{
+    m_inputLog = std::move(log);
+    m_divergedFrames = 0;
+    m_replaying = true;
+}
+
+void GameEngine::stopReplay()
+{
+    if (!m_replaying) {return;}
+
+    m_replaying = false;
+    if (m_divergedFrames == 0) {std::cout << "Replay matched all " << m_inputLog.frames() << " recorded frames" << std::endl;}
+    else {std::cout << "Replay diverged on " << m_divergedFrames << " of " << m_inputLog.frames() << " recorded frames" << std::endl;}
+}
+
+size_t GameEngine::divergedFrames() const
+{
+    return m_divergedFrames;
+}
+
+const InputLog& GameEngine::inputLog() const
+{
+    return m_inputLog;
+}
+
+// Feed the recorded actions for the upcoming frame through the same path as live input
+void GameEngine::sReplayInput(Scene& scene)
+{
+    if (!m_replaying) {return;}
+
+    // The recording ends here, stop instead of simulating without input
+    if (!m_inputLog.hasHash(scene.currentFrame()))
+    {
+        quit();
+        return;
+    }
+
+    m_inputLog.replay(scene.currentFrame(), m_inputBuffer);
+    for (auto action : m_inputBuffer) {scene.sDoAction(action);}
+    m_inputBuffer.clear();
+}
+
+void GameEngine::sStateHash(Scene& scene)
+{
+    if (m_recording)
+    {
+        m_inputLog.recordHash(scene.currentFrame(), scene.stateHash());
+    }
+    else if (m_replaying && m_inputLog.hasHash(scene.currentFrame()))
+    {
+        uint64_t hash = scene.stateHash();
+        if (hash != m_inputLog.hash(scene.currentFrame()))
+        {
+            if (m_divergedFrames == 0)
+            {
+                std::cerr << "Replay diverged at frame " << scene.currentFrame() << ": expected " << std::hex
+                          << m_inputLog.hash(scene.currentFrame()) << ", got " << hash << std::dec << std::endl;
+            }
+            m_divergedFrames++;
+        }
+    }
+}
\ No newline at end of file
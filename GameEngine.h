@@ -3,11 +3,16 @@
 #include <memory>
 #include <map>
 #include <string>
+#include <algorithm>
+#include <chrono>
 #include <SFML/Graphics.hpp>
 #include "Scene.h"
 #include "Scene_Menu.h"
 //#include "Scene_Play.h"
 #include "Assets.h"
+#include "InputLog.h"
+#include "JobSystem.h"
+#include "Renderer.h"
 
 typedef std::map<std::string, std::shared_ptr<Scene>> SceneMap;
 
@@ -15,28 +20,69 @@ class GameEngine
 {
 protected:
     sf::RenderWindow    m_window;
+    Renderer            m_renderer;                // draws m_window on its own thread while run() is running
     Assets              m_assets;
     std::string         m_currentScene;
     SceneMap            m_sceneMap;
-    size_t              m_simulationSpeed = 1;
+    size_t              m_simulationSpeed = 1;     // simulation steps per tick
+    const std::chrono::nanoseconds m_tick = std::chrono::nanoseconds(1000000000 / 60);  // fixed update rate of windowed runs
+    size_t              m_sceneChanges = 0;        // tells the renderer when its cached quads belong to another scene
+    float               m_cullMargin = 128;        // pixels around the view still rendered
+    std::string         m_profilePath;             // CSV file for per-frame profiler stats, empty for none
     bool                m_running = true;
+    bool                m_headless = false;        // no window: scenes are simulated but never rendered
+    const Vec2          m_headlessSize = {1280, 720};
+    InputLog            m_inputLog;
+    std::string         m_recordPath;              // input log written when the recorded scene ends
+    bool                m_recording = false;
+    bool                m_replaying = false;
+    size_t              m_divergedFrames = 0;
+    std::vector<Action> m_inputBuffer;             // actions for the upcoming frame, reused every frame
+    JobSystem           m_jobs;                    // worker threads shared by all scenes
 
     void init(const std::string path);
     void update();
+    void publishSnapshot();
 
     void sUserInput();
+    void dispatchInput(bool record);
+    void stopRecording();
+    void stopReplay();
 
     std::shared_ptr<Scene> currentScene();
 
 public:
-    GameEngine(const std::string& path);
+    GameEngine(const std::string& path, bool headless = false);
 
     void changeScene(const std::string& sceneName, std::shared_ptr<Scene> scene, bool endCurrentScene = false);
 
     void                quit();
-    void                run();
+    void                waitForAssets();
+    void                run(size_t maxFrames = 0);
 
-    sf::RenderWindow&   window();
+    const Renderer&     renderer() const;
     const Assets&       assets() const;
     bool                isRunning();
+    bool                isHeadless() const;
+    size_t              width() const;
+    size_t              height() const;
+    size_t              simulationSpeed() const;
+    void                setSimulationSpeed(size_t speed);
+    float               cullMargin() const;
+    void                setCullMargin(float margin);
+    const std::string&  profilePath() const;
+    void                setProfilePath(const std::string& path);
+    JobSystem&          jobs();
+    void                setWorkerThreads(size_t threads);
+    void                setTextureBudget(size_t bytes);
+
+    // Record/replay of the current scene's input. Both stop when the scene changes
+    void                startRecording(const std::string& logPath, const std::string& levelPath);
+    void                startReplay(InputLog log);      // a log load()ed by the caller, played from its first frame
+    size_t              divergedFrames() const;
+    const InputLog&     inputLog() const;
+
+    // Called by Scene::simulate around every fixed step
+    void                sReplayInput(Scene& scene);
+    void                sStateHash(Scene& scene);
 };
\ No newline at end of file
@@ -0,0 +1,143 @@
+#include "InputLog.h"
+#include <iostream>
+#include <algorithm>
+
+namespace
+{
+    const char      MAGIC[4]    = {'M', 'M', 'I', 'L'};
+    const uint32_t  VERSION     = 2;
+
+    template <typename T>
+    void write(std::ofstream& fout, T value)
+    {
+        for (size_t i = 0; i < sizeof(T); i++) {fout.put((char)((value >> (8 * i)) & 0xFF));}
+    }
+
+    template <typename T>
+    T read(std::ifstream& fin)
+    {
+        T value = 0;
+        for (size_t i = 0; i < sizeof(T); i++) {value |= (T)(uint8_t)fin.get() << (8 * i);}
+        return value;
+    }
+}
+
+InputLog::InputLog() {}
+
+void InputLog::clear(const std::string& levelPath)
+{
+    m_levelPath = levelPath;
+    m_events.clear();
+    m_frameHashes.clear();
+    m_nextEvent = 0;
+}
+
+void InputLog::record(size_t frame, const Action& action)
+{
+    InputEvent event;
+    event.frame  = (uint32_t)frame;
+    event.action = action.code();
+    m_events.push_back(event);
+}
+
+void InputLog::recordHash(size_t frame, uint64_t hash)
+{
+    if (frame >= m_frameHashes.size()) {m_frameHashes.resize(frame + 1, 0);}
+    m_frameHashes[frame] = hash;
+}
+
+void InputLog::replay(size_t frame, std::vector<Action>& out)
+{
+    while (m_nextEvent < m_events.size() && m_events[m_nextEvent].frame <= frame)
+    {
+        auto& event = m_events[m_nextEvent++];
+        out.push_back(Action::fromCode(event.action));
+    }
+}
+
+bool InputLog::hasHash(size_t frame) const
+{
+    return frame < m_frameHashes.size();
+}
+
+uint64_t InputLog::hash(size_t frame) const
+{
+    return m_frameHashes[frame];
+}
+
+size_t InputLog::frames() const
+{
+    return m_frameHashes.size();
+}
+
+const std::string& InputLog::levelPath() const
+{
+    return m_levelPath;
+}
+
+bool InputLog::save(const std::string& path) const
+{
+    std::ofstream fout(path, std::ios::binary);
+    if (!fout) {std::cerr << "Could not write input log: " << path << std::endl; return false;}
+
+    fout.write(MAGIC, 4);
+    write<uint32_t>(fout, VERSION);
+
+    write<uint16_t>(fout, (uint16_t)m_levelPath.size());
+    fout.write(m_levelPath.data(), m_levelPath.size());
+
+    write<uint32_t>(fout, (uint32_t)m_events.size());
+    for (auto& event : m_events)
+    {
+        write<uint32_t>(fout, event.frame);
+        write<uint8_t>(fout, event.action);
+    }
+
+    write<uint32_t>(fout, (uint32_t)m_frameHashes.size());
+    for (auto hash : m_frameHashes) {write<uint64_t>(fout, hash);}
+
+    return (bool)fout;
+}
+
+bool InputLog::load(const std::string& path)
+{
+    std::ifstream fin(path, std::ios::binary | std::ios::ate);
+    std::streamoff fileSize = fin ? (std::streamoff)fin.tellg() : 0;
+    fin.seekg(0);
+
+    // Counts are checked against the bytes left so a corrupt log cannot ask for gigabytes
+    auto fits = [&](uint32_t count, size_t bytesEach)
+    {
+        return fin && (uint64_t)count * bytesEach <= (uint64_t)(fileSize - (std::streamoff)fin.tellg());
+    };
+
+    char magic[4] = {};
+    fin.read(magic, 4);
+
+    if (!fin || !std::equal(magic, magic + 4, MAGIC) || read<uint32_t>(fin) != VERSION)
+    {
+        std::cerr << "Not a valid input log: " << path << std::endl;
+        return false;
+    }
+
+    clear("");
+    m_levelPath.resize(read<uint16_t>(fin));
+    fin.read(&m_levelPath[0], m_levelPath.size());
+
+    uint32_t eventCount = read<uint32_t>(fin);
+    if (!fits(eventCount, 5)) {std::cerr << "Corrupt input log: " << path << std::endl; return false;}
+    m_events.resize(eventCount);
+    for (auto& event : m_events)
+    {
+        event.frame  = read<uint32_t>(fin);
+        event.action = read<uint8_t>(fin);
+    }
+
+    uint32_t hashCount = read<uint32_t>(fin);
+    if (!fits(hashCount, 8)) {std::cerr << "Corrupt input log: " << path << std::endl; return false;}
+    m_frameHashes.resize(hashCount);
+    for (auto& hash : m_frameHashes) {hash = read<uint64_t>(fin);}
+
+    if (!fin) {std::cerr << "Truncated input log: " << path << std::endl; return false;}
+    return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include "Action.h"
+
+// Compact binary log of the Actions a scene received, keyed by simulation frame, plus a hash of
+// the simulation state after every frame so a replay can detect the first frame that diverges.
+//
+// File layout (little-endian):
+//   "MMIL" u32 version
+//   u16 length + level path
+//   u32 event count, then u32 frame + u8 Action::code() (scene action id, END_BIT for END) per event
+//   u32 frame count, then u64 state hash per frame
+class InputLog
+{
+    struct InputEvent
+    {
+        uint32_t    frame   = 0;
+        uint8_t     action  = 0;    // Action::code()
+    };
+
+    std::string                 m_levelPath;
+    std::vector<InputEvent>     m_events;
+    std::vector<uint64_t>       m_frameHashes;
+    size_t                      m_nextEvent = 0;    // replay cursor into m_events
+
+public:
+    InputLog();
+
+    void clear(const std::string& levelPath);
+    void record(size_t frame, const Action& action);
+    void recordHash(size_t frame, uint64_t hash);
+
+    // Appends the recorded actions for this frame to out, frames must be replayed in order
+    void replay(size_t frame, std::vector<Action>& out);
+
+    bool        hasHash(size_t frame) const;
+    uint64_t    hash(size_t frame) const;
+    size_t      frames() const;
+
+    const std::string& levelPath() const;
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+};
@@ -0,0 +1,162 @@
+#include "JobSystem.h"
+
+// Queue of the worker running on this thread, -1 outside the pool
+static thread_local size_t t_queue = (size_t)-1;
+
+JobSystem::JobSystem(size_t workers)
+{
+    setWorkerCount(workers);
+}
+
+JobSystem::~JobSystem()
+{
+    setWorkerCount(0);
+}
+
+void JobSystem::setWorkerCount(size_t workers)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto& thread : m_threads) {thread.join();}
+
+    m_threads.clear();
+    m_queues = std::vector<Queue>(workers);
+    m_stopping = false;
+
+    for (size_t i = 0; i < workers; i++) {m_threads.emplace_back(&JobSystem::workerLoop, this, i);}
+}
+
+size_t JobSystem::workerCount() const
+{
+    return m_threads.size();
+}
+
+size_t JobSystem::threadIndex() const
+{
+    return t_queue + 1;
+}
+
+void JobSystem::workerLoop(size_t queue)
+{
+    t_queue = queue;
+
+    while (true)
+    {
+        if (runOne(queue)) {continue;}
+
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_wake.wait(lock, [this] {return m_stopping || m_queued > 0;});
+        if (m_stopping && m_queued == 0) {return;}
+    }
+}
+
+// Runs a job from the thread's own queue, or one stolen from another queue
+bool JobSystem::runOne(size_t queue)
+{
+    Job job;
+    if (!pop(queue, job) && !steal(queue, job)) {return false;}
+
+    job.function(job.context, job.begin, job.end);
+    job.pending->fetch_sub(1);
+    return true;
+}
+
+bool JobSystem::pop(size_t queue, Job& job)
+{
+    if (queue >= m_queues.size()) {return false;}
+
+    auto& q = m_queues[queue];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.jobs.size() == q.head) {return false;}
+
+    job = q.jobs.back();
+    q.jobs.pop_back();
+    m_queued--;
+    if (q.jobs.size() == q.head) {q.jobs.clear(); q.head = 0;}
+    return true;
+}
+
+bool JobSystem::steal(size_t queue, Job& job)
+{
+    for (size_t i = 1; i <= m_queues.size(); i++)
+    {
+        auto& q = m_queues[(queue + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.jobs.size() == q.head) {continue;}
+
+        job = q.jobs[q.head++];
+        m_queued--;
+        if (q.jobs.size() == q.head) {q.jobs.clear(); q.head = 0;}
+        return true;
+    }
+    return false;
+}
+
+void JobSystem::dispatch(size_t count, size_t grain, JobFunction function, void* context)
+{
+    size_t chunks = (count + grain - 1) / grain;
+    std::atomic<size_t> pending(chunks);
+
+    for (size_t chunk = 0; chunk < chunks; chunk++)
+    {
+        Job job = {function, context, chunk * grain, std::min(count, (chunk + 1) * grain), &pending};
+
+        auto& q = m_queues[m_nextQueue++ % m_queues.size()];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        q.jobs.push_back(job);
+        m_queued++;
+    }
+
+    // Taking the lock orders the new jobs before any worker's check of m_queued, so none sleeps through them
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+    }
+    m_wake.notify_all();
+
+    // Help instead of blocking, this thread may itself be a worker waiting on a nested parallelFor
+    while (pending > 0)
+    {
+        if (!runOne(t_queue)) {std::this_thread::yield();}
+    }
+}
+
+void SystemScheduler::add(uint32_t reads, uint32_t writes, std::function<void()> run)
+{
+    // A system starts after the last earlier system it conflicts with
+    size_t stage = 0;
+    for (size_t i = 0; i < m_systems.size(); i++)
+    {
+        auto& other = m_systems[i];
+        bool conflict = (writes & (other.reads | other.writes)) || (reads & other.writes);
+        if (!conflict) {continue;}
+
+        for (size_t s = 0; s < m_stages.size(); s++)
+        {
+            if (std::find(m_stages[s].begin(), m_stages[s].end(), i) != m_stages[s].end()) {stage = std::max(stage, s + 1);}
+        }
+    }
+
+    if (stage == m_stages.size()) {m_stages.emplace_back();}
+    m_stages[stage].push_back(m_systems.size());
+    m_systems.push_back({std::move(run), reads, writes});
+}
+
+void SystemScheduler::clear()
+{
+    m_systems.clear();
+    m_stages.clear();
+}
+
+void SystemScheduler::run(JobSystem& jobs)
+{
+    for (auto& stage : m_stages)
+    {
+        jobs.parallelFor(stage.size(), 1, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++) {m_systems[stage[i]].run();}
+        });
+    }
+}
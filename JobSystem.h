@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <type_traits>
+#include <cstdint>
+
+// Thread pool with one job queue per worker. Jobs are handed out round-robin, a worker takes
+// from the back of its own queue and steals from the front of the others' when it runs dry.
+// The thread that submits work also runs jobs while it waits, so nested parallelFor calls from
+// inside a job cannot deadlock, and a pool without workers runs everything inline.
+class JobSystem
+{
+    typedef void (*JobFunction)(void* context, size_t begin, size_t end);
+
+    struct Job
+    {
+        JobFunction             function = nullptr;
+        void*                   context = nullptr;
+        size_t                  begin = 0;
+        size_t                  end = 0;
+        std::atomic<size_t>*    pending = nullptr;      // decremented when the job is done
+    };
+
+    struct Queue
+    {
+        std::mutex              mutex;
+        std::vector<Job>        jobs;
+        size_t                  head = 0;               // jobs before head have been stolen
+    };
+
+    std::vector<std::thread>    m_threads;
+    std::vector<Queue>          m_queues;               // one per worker
+    std::mutex                  m_wakeMutex;
+    std::condition_variable     m_wake;
+    std::atomic<size_t>         m_queued = {0};         // jobs waiting in any queue, changed under that queue's mutex
+    std::atomic<size_t>         m_nextQueue = {0};
+    bool                        m_stopping = false;
+
+    void workerLoop(size_t queue);
+    bool runOne(size_t queue);
+    bool pop(size_t queue, Job& job);
+    bool steal(size_t queue, Job& job);
+    void dispatch(size_t count, size_t grain, JobFunction function, void* context);
+
+public:
+    JobSystem(size_t workers = 0);
+    ~JobSystem();
+
+    // Stops the current workers and starts this many. 0 runs every job on the calling thread
+    void   setWorkerCount(size_t workers);
+    size_t workerCount() const;
+
+    // Index of the calling thread: 0 for threads outside the pool, 1 to workerCount() for workers.
+    // Use it to pick per-thread scratch buffers inside a job
+    size_t threadIndex() const;
+
+    // Calls fn(begin, end) over [0, count) in ranges of at most grain and returns once all are done.
+    // Ranges run in any order and on any thread, so fn must only write data owned by its range
+    template <typename F>
+    void parallelFor(size_t count, size_t grain, F&& fn)
+    {
+        if (count == 0) {return;}
+        if (m_threads.empty() || count <= grain) {fn(0, count); return;}
+
+        auto call = [](void* context, size_t begin, size_t end) {(*static_cast<std::remove_reference_t<F>*>(context))(begin, end);};
+        dispatch(count, grain, call, &fn);
+    }
+};
+
+// Runs a frame's systems in the order they were added. Each system declares the components it
+// reads and writes as bit masks; a system waits for every earlier system whose writes it reads or
+// whose reads or writes it writes, and systems without such conflicts run at the same time.
+// Systems that add or destroy entities must declare EXCLUSIVE, since that can reallocate any
+// component array.
+class SystemScheduler
+{
+public:
+    static const uint32_t EXCLUSIVE = 0xFFFFFFFF;
+
+private:
+    struct System
+    {
+        std::function<void()>   run;
+        uint32_t                reads = 0;
+        uint32_t                writes = 0;
+    };
+
+    std::vector<System>                 m_systems;
+    std::vector<std::vector<size_t>>    m_stages;   // systems of a stage do not conflict with each other
+
+public:
+    void add(uint32_t reads, uint32_t writes, std::function<void()> run);
+    void clear();
+
+    // Runs every system, stage by stage. Results equal running them serially in order
+    void run(JobSystem& jobs);
+};
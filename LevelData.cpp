@@ -0,0 +1,293 @@
+#include "LevelData.h"
+#include <fstream>
+#include <iostream>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const char      MAGIC[4]    = {'M', 'M', 'L', 'V'};
+    const uint32_t  VERSION     = 2;
+
+    // Read-only view of a whole file, memory-mapped where the platform allows it
+    class MappedFile
+    {
+        const uint8_t*          m_data = nullptr;
+        size_t                  m_size = 0;
+        std::vector<uint8_t>    m_buffer;
+#ifdef __unix__
+        void*                   m_map = nullptr;
+#endif
+
+    public:
+        MappedFile(const std::string& path)
+        {
+#ifdef __unix__
+            int fd = open(path.c_str(), O_RDONLY);
+            struct stat info;
+            if (fd < 0) {return;}
+            if (fstat(fd, &info) == 0 && info.st_size > 0)
+            {
+                m_map = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (m_map == MAP_FAILED) {m_map = nullptr;}
+                else {m_data = (const uint8_t*)m_map; m_size = info.st_size;}
+            }
+            close(fd);
+#else
+            std::ifstream fin(path, std::ios::binary);
+            m_buffer.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+            m_data = m_buffer.data();
+            m_size = m_buffer.size();
+#endif
+        }
+
+        ~MappedFile()
+        {
+#ifdef __unix__
+            if (m_map) {munmap(m_map, m_size);}
+#endif
+        }
+
+        const uint8_t*  data() const {return m_data;}
+        size_t          size() const {return m_size;}
+    };
+
+    // Bounds-checked little-endian reader over a mapped file
+    class Reader
+    {
+        const uint8_t*  m_data;
+        size_t          m_size;
+        size_t          m_pos = 0;
+
+    public:
+        bool ok = true;
+
+        Reader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+        template <typename T>
+        T read()
+        {
+            T value = 0;
+            if (m_pos + sizeof(T) > m_size) {ok = false; return value;}
+            for (size_t i = 0; i < sizeof(T); i++) {value |= (T)m_data[m_pos + i] << (8 * i);}
+            m_pos += sizeof(T);
+            return value;
+        }
+
+        float readFloat()
+        {
+            uint32_t bits = read<uint32_t>();
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        std::string readString(size_t length)
+        {
+            if (m_pos + length > m_size) {ok = false; return "";}
+            std::string value((const char*)m_data + m_pos, length);
+            m_pos += length;
+            return value;
+        }
+    };
+
+    template <typename T>
+    void write(std::ofstream& fout, T value)
+    {
+        for (size_t i = 0; i < sizeof(T); i++) {fout.put((char)((value >> (8 * i)) & 0xFF));}
+    }
+
+    void writeFloat(std::ofstream& fout, float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        write<uint32_t>(fout, bits);
+    }
+}
+
+void LevelData::clear()
+{
+    *this = LevelData();
+}
+
+uint16_t LevelData::animationId(const std::string& name)
+{
+    for (size_t i = 0; i < animations.size(); i++)
+    {
+        if (animations[i] == name) {return (uint16_t)i;}
+    }
+
+    animations.push_back(name);
+    return (uint16_t)(animations.size() - 1);
+}
+
+bool LevelData::isBinary(const std::string& path)
+{
+    std::ifstream fin(path, std::ios::binary);
+    char magic[4] = {};
+    fin.read(magic, 4);
+    return fin && std::memcmp(magic, MAGIC, 4) == 0;
+}
+
+bool LevelData::load(const std::string& path)
+{
+    return isBinary(path) ? loadBinary(path) : loadText(path);
+}
+
+bool LevelData::loadText(const std::string& path)
+{
+    clear();
+
+    std::ifstream fin(path);
+    if (!fin) {std::cerr << "Could not open level file: " << path << std::endl; return false;}
+
+    std::string temp;
+
+    while (fin >> temp)
+    {
+        if (temp == "Tile" || temp == "Dec")
+        {
+            std::string animName;
+            TileSpec tile;
+            fin >> animName >> tile.gridX >> tile.gridY;            // Animation name, grid position (x,y) = (64 x 64px)
+            if (!fin) {std::cerr << "Incomplete " << temp << " line in " << path << std::endl; return false;}
+
+            tile.kind = (temp == "Tile") ? TILE : DEC;              // Tile has a bounding box, Dec does not
+            tile.animation = animationId(animName);
+            tiles.push_back(tile);
+        }
+        else if (temp == "Player")
+        {
+            fin >> player.CHARACTER                                 // Player character texture
+                >> player.X >> player.Y                             // Player starting position (x, y)
+                >> player.CX >> player.CY                           // Player collision box height, width (x, y)
+                >> player.SPEED >> player.MAXSPEED                  // Player horizontal move speed, max speed (unused, collisions are swept)
+                >> player.JUMP >> player.MAXJUMP                    // Player vertical jump speed (-y = up), gravity (+y = down)
+                >> player.GRAVITY;
+            if (!fin) {std::cerr << "Incomplete Player line in " << path << std::endl; return false;}
+
+            playerIndex = (uint32_t)tiles.size();                   // the player is spawned in file order
+        }
+        else if (temp == "Weapon")
+        {
+            fin >> weapon.WEAPON                                    // Weapon bullet texture
+                >> weapon.SPEED                                     // Bullet speed (pixels/frame)
+                >> weapon.LIFESPAN;                                 // Bullet lifespan (frames)
+            if (!fin) {std::cerr << "Incomplete Weapon line in " << path << std::endl; return false;}
+            hasWeapon = true;
+        }
+    }
+
+    return true;
+}
+
+bool LevelData::loadBinary(const std::string& path)
+{
+    clear();
+
+    MappedFile file(path);
+    Reader in(file.data(), file.size());
+
+    if (in.readString(4) != std::string(MAGIC, 4) || in.read<uint32_t>() != VERSION)
+    {
+        std::cerr << "Not a compiled level: " << path << std::endl;
+        return false;
+    }
+
+    animations.resize(in.read<uint16_t>());
+    for (auto& name : animations) {name = in.readString(in.read<uint8_t>());}
+
+    uint32_t tileCount = in.read<uint32_t>();
+    if (!in.ok || tileCount > file.size()) {std::cerr << "Corrupt compiled level: " << path << std::endl; return false;}
+
+    tiles.resize(tileCount);
+    for (auto& tile : tiles)
+    {
+        uint8_t kind    = in.read<uint8_t>();
+        tile.kind       = (TileKind)kind;
+        tile.animation  = in.read<uint16_t>();
+        tile.gridX      = in.readFloat();
+        tile.gridY      = in.readFloat();
+        if (kind > DEC || tile.animation >= animations.size()) {in.ok = false;}
+    }
+
+    // The player is spawned before tile playerIndex, or after the last tile when it equals tiles.size()
+    playerIndex = in.read<uint32_t>();
+    if (playerIndex != NO_PLAYER && playerIndex > tiles.size()) {in.ok = false;}
+    uint16_t character = in.read<uint16_t>();
+    float* playerValues[] = {&player.X, &player.Y, &player.CX, &player.CY, &player.SPEED, &player.MAXSPEED, &player.JUMP, &player.MAXJUMP, &player.GRAVITY};
+    for (auto value : playerValues) {*value = in.readFloat();}
+    if (playerIndex != NO_PLAYER && character < animations.size()) {player.CHARACTER = animations[character];}
+
+    hasWeapon = in.read<uint8_t>() != 0;
+    uint16_t bullet = in.read<uint16_t>();
+    weapon.SPEED    = in.readFloat();
+    weapon.LIFESPAN = in.readFloat();
+    if (hasWeapon && bullet < animations.size()) {weapon.WEAPON = animations[bullet];}
+
+    if (!in.ok) {std::cerr << "Corrupt compiled level: " << path << std::endl; return false;}
+    return true;
+}
+
+bool LevelData::saveBinary(const std::string& path) const
+{
+    // Player and weapon animations share the tile name table
+    LevelData copy = *this;
+    uint16_t character  = (playerIndex != NO_PLAYER) ? copy.animationId(player.CHARACTER) : 0;
+    uint16_t bullet     = hasWeapon ? copy.animationId(weapon.WEAPON) : 0;
+
+    // Checked before the file is opened, so a level that does not fit never leaves a truncated one behind
+    if (copy.animations.size() > std::numeric_limits<uint16_t>::max() || tiles.size() >= NO_PLAYER)
+    {
+        std::cerr << "Too many animations or tiles to compile: " << path << std::endl;
+        return false;
+    }
+    for (auto& name : copy.animations)
+    {
+        if (name.size() > std::numeric_limits<uint8_t>::max()) {std::cerr << "Animation name longer than 255 bytes: " << name << std::endl; return false;}
+    }
+
+    std::ofstream fout(path, std::ios::binary);
+    if (!fout) {std::cerr << "Could not write compiled level: " << path << std::endl; return false;}
+
+    fout.write(MAGIC, 4);
+    write<uint32_t>(fout, VERSION);
+
+    write<uint16_t>(fout, (uint16_t)copy.animations.size());
+    for (auto& name : copy.animations)
+    {
+        write<uint8_t>(fout, (uint8_t)name.size());
+        fout.write(name.data(), name.size());
+    }
+
+    write<uint32_t>(fout, (uint32_t)tiles.size());
+    for (auto& tile : tiles)
+    {
+        write<uint8_t>(fout, tile.kind);
+        write<uint16_t>(fout, tile.animation);
+        writeFloat(fout, tile.gridX);
+        writeFloat(fout, tile.gridY);
+    }
+
+    write<uint32_t>(fout, playerIndex);
+    write<uint16_t>(fout, character);
+    for (float value : {player.X, player.Y, player.CX, player.CY, player.SPEED, player.MAXSPEED, player.JUMP, player.MAXJUMP, player.GRAVITY})
+    {
+        writeFloat(fout, value);
+    }
+
+    write<uint8_t>(fout, hasWeapon ? 1 : 0);
+    write<uint16_t>(fout, bullet);
+    writeFloat(fout, weapon.SPEED);
+    writeFloat(fout, weapon.LIFESPAN);
+
+    return (bool)fout;
+}
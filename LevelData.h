@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+struct PlayerConfig
+{
+    float X = 0, Y = 0, CX = 0, CY = 0, SPEED = 0, MAXSPEED = 0, JUMP = 0, MAXJUMP = 0, GRAVITY = 0;
+    std::string CHARACTER, WEAPON;
+};
+
+struct WeaponConfig
+{
+    float SPEED = 0, LIFESPAN = 0;
+    std::string WEAPON;
+};
+
+// Contents of a level file, independent of whether it was read from the text format
+// (Tile/Dec/Player/Weapon lines) or from a binary level compiled by tools/levelc.
+//
+// Binary layout (little-endian):
+//   "MMLV" u32 version
+//   u16 animation count, then u8 length + name per animation id
+//   u32 tile count, then u8 kind + u16 animation id + f32 grid x + f32 grid y per tile
+//   u32 number of tiles spawned before the player (NO_PLAYER if there is none)
+//   u16 character animation id + 9 x f32 player config
+//   u8 has weapon, u16 weapon animation id + 2 x f32 weapon config
+class LevelData
+{
+public:
+    enum TileKind : uint8_t { TILE = 0, DEC = 1 };      // Dec tiles have no bounding box
+
+    struct TileSpec
+    {
+        TileKind    kind        = TILE;
+        uint16_t    animation   = 0;                    // index into animations
+        float       gridX       = 0;                    // whole cells, fractions are allowed as in the text format
+        float       gridY       = 0;
+    };
+
+    static const uint32_t NO_PLAYER = 0xFFFFFFFF;
+
+    std::vector<std::string>    animations;             // interned animation names
+    std::vector<TileSpec>       tiles;
+    uint32_t                    playerIndex = NO_PLAYER;
+    PlayerConfig                player;
+    bool                        hasWeapon = false;
+    WeaponConfig                weapon;
+
+    // Loads either format, binary files are recognised by their magic number
+    bool load(const std::string& path);
+    bool loadText(const std::string& path);
+    bool loadBinary(const std::string& path);
+    bool saveBinary(const std::string& path) const;     // fails, writing nothing, if a name or count does not fit the layout
+    static bool isBinary(const std::string& path);
+
+private:
+    uint16_t animationId(const std::string& name);
+    void clear();
+};
@@ -1,34 +1,41 @@
 #include "Physics.h"
+#include <limits>
+#include <utility>
 
-Vec2 Physics::getOverlap(std::shared_ptr<Entity> a, std::shared_ptr<Entity> b)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PHYSICS_SSE2
+#endif
+
+Vec2 Physics::getOverlap(const Entity& a, const Entity& b)
 {
-    Vec2 aPos = a->getComponent<CTransform>().pos;
-    Vec2 bPos = b->getComponent<CTransform>().pos;
+    Vec2 aPos = a.getComponent<CTransform>().pos;
+    Vec2 bPos = b.getComponent<CTransform>().pos;
 
     float dx = fabsf(aPos.x - bPos.x);
     float dy = fabsf(aPos.y - bPos.y); 
     
-    Vec2 aHalfSize = a->getComponent<CBoundingBox>().halfSize;
-    Vec2 bHalfSize = b->getComponent<CBoundingBox>().halfSize;
+    Vec2 aHalfSize = a.getComponent<CBoundingBox>().halfSize;
+    Vec2 bHalfSize = b.getComponent<CBoundingBox>().halfSize;
 
     return Vec2((aHalfSize.x + bHalfSize.x) - dx, (aHalfSize.y + bHalfSize.y) - dy);
 }
 
-Vec2 Physics::getPreviousOverlap(std::shared_ptr<Entity> a, std::shared_ptr<Entity> b)
+Vec2 Physics::getPreviousOverlap(const Entity& a, const Entity& b)
 {
-    Vec2 aPos = a->getComponent<CTransform>().prevPos;
-    Vec2 bPos = b->getComponent<CTransform>().prevPos;
+    Vec2 aPos = a.getComponent<CTransform>().prevPos;
+    Vec2 bPos = b.getComponent<CTransform>().prevPos;
 
     float dx = fabsf(aPos.x - bPos.x);
     float dy = fabsf(aPos.y - bPos.y); 
     
-    Vec2 aHalfSize = a->getComponent<CBoundingBox>().halfSize;
-    Vec2 bHalfSize = b->getComponent<CBoundingBox>().halfSize;
+    Vec2 aHalfSize = a.getComponent<CBoundingBox>().halfSize;
+    Vec2 bHalfSize = b.getComponent<CBoundingBox>().halfSize;
 
     return Vec2((aHalfSize.x + bHalfSize.x) - dx, (aHalfSize.y + bHalfSize.y) - dy);
 }
 
-bool Physics::isCollision(std::shared_ptr<Entity> a, std::shared_ptr<Entity> b)
+bool Physics::isCollision(const Entity& a, const Entity& b)
 {
     Vec2 overlap = getOverlap(a, b);
     
@@ -38,4 +45,127 @@ bool Physics::isCollision(std::shared_ptr<Entity> a, std::shared_ptr<Entity> b)
 bool Physics::isCollision(Vec2 overlap)
 {
     return ((overlap.x > 0) && (overlap.y > 0));
+}
+
+Physics::Sweep Physics::sweep(const Vec2& from, const Vec2& to, const Vec2& halfSize, const Vec2& staticPos, const Vec2& staticHalfSize)
+{
+    Sweep result;
+
+    float delta[2]  = {to.x - from.x, to.y - from.y};
+    float offset[2] = {from.x - staticPos.x, from.y - staticPos.y};
+    float extent[2] = {halfSize.x + staticHalfSize.x, halfSize.y + staticHalfSize.y};
+
+    float entry = -std::numeric_limits<float>::infinity();
+    float exit  =  std::numeric_limits<float>::infinity();
+    Vec2  normal;
+
+    for (int axis = 0; axis < 2; axis++)
+    {
+        // Not moving on this axis: must already overlap on it for the whole movement
+        if (delta[axis] == 0)
+        {
+            if (fabsf(offset[axis]) >= extent[axis]) {return result;}
+            continue;
+        }
+
+        // Times at which the offset crosses both edges of the Minkowski sum
+        float t0 = (-extent[axis] - offset[axis]) / delta[axis];
+        float t1 = ( extent[axis] - offset[axis]) / delta[axis];
+        if (t0 > t1) {std::swap(t0, t1);}
+
+        if (t0 > entry)
+        {
+            entry = t0;
+            float side = (delta[axis] > 0) ? -1.0f : 1.0f;
+            normal = (axis == 0) ? Vec2(side, 0) : Vec2(0, side);
+        }
+        exit = fminf(exit, t1);
+    }
+
+    // Overlapping at the start, touching only, or no contact before the end of this movement
+    if (entry < 0 || entry >= 1 || entry >= exit) {return result;}
+
+    result.hit    = true;
+    result.time   = entry;
+    result.normal = normal;
+    return result;
+}
+
+Physics::Sweep Physics::sweep(const Entity& a, const Entity& b)
+{
+    auto& transform = a.getComponent<CTransform>();
+
+    return sweep(transform.prevPos, transform.pos, a.getComponent<CBoundingBox>().halfSize,
+                 b.getComponent<CTransform>().pos, b.getComponent<CBoundingBox>().halfSize);
+}
+
+Vec2 Physics::getSweptOverlap(const Entity& a, const Entity& b, const Sweep& sweep)
+{
+    Vec2 d = a.getComponent<CTransform>().pos - b.getComponent<CTransform>().pos;
+    Vec2 extent = a.getComponent<CBoundingBox>().halfSize + b.getComponent<CBoundingBox>().halfSize;
+
+    return Vec2(sweep.normal.x != 0 ? extent.x - sweep.normal.x * d.x : 0,
+                sweep.normal.y != 0 ? extent.y - sweep.normal.y * d.y : 0);
+}
+
+void Physics::BoxBatch::clear()
+{
+    x.clear();
+    y.clear();
+    halfX.clear();
+    halfY.clear();
+}
+
+void Physics::BoxBatch::add(const Vec2& pos, const Vec2& halfSize)
+{
+    x.push_back(pos.x);
+    y.push_back(pos.y);
+    halfX.push_back(halfSize.x);
+    halfY.push_back(halfSize.y);
+}
+
+size_t Physics::BoxBatch::size() const
+{
+    return x.size();
+}
+
+void Physics::getOverlaps(const Vec2& pos, const Vec2& halfSize, const BoxBatch& batch, Overlaps& out)
+{
+    size_t count = batch.size();
+    out.x.resize(count);
+    out.y.resize(count);
+    out.hits.assign((count + 63) / 64, 0);
+
+    size_t i = 0;
+
+#ifdef PHYSICS_SSE2
+    const __m128 px     = _mm_set1_ps(pos.x);
+    const __m128 py     = _mm_set1_ps(pos.y);
+    const __m128 hx     = _mm_set1_ps(halfSize.x);
+    const __m128 hy     = _mm_set1_ps(halfSize.y);
+    const __m128 zero   = _mm_setzero_ps();
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+    // Same operations as getOverlap, so results are bit for bit equal to the scalar path
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 dx = _mm_and_ps(_mm_sub_ps(_mm_loadu_ps(&batch.x[i]), px), absMask);
+        __m128 dy = _mm_and_ps(_mm_sub_ps(_mm_loadu_ps(&batch.y[i]), py), absMask);
+        __m128 ox = _mm_sub_ps(_mm_add_ps(hx, _mm_loadu_ps(&batch.halfX[i])), dx);
+        __m128 oy = _mm_sub_ps(_mm_add_ps(hy, _mm_loadu_ps(&batch.halfY[i])), dy);
+
+        _mm_storeu_ps(&out.x[i], ox);
+        _mm_storeu_ps(&out.y[i], oy);
+
+        uint64_t mask = (uint64_t)_mm_movemask_ps(_mm_and_ps(_mm_cmpgt_ps(ox, zero), _mm_cmpgt_ps(oy, zero)));
+        out.hits[i / 64] |= mask << (i % 64);
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        out.x[i] = (halfSize.x + batch.halfX[i]) - fabsf(batch.x[i] - pos.x);
+        out.y[i] = (halfSize.y + batch.halfY[i]) - fabsf(batch.y[i] - pos.y);
+        if (out.x[i] > 0 && out.y[i] > 0) {out.hits[i / 64] |= (uint64_t)1 << (i % 64);}
+    }
 }
\ No newline at end of file
@@ -2,15 +2,59 @@
 
 #include <memory>
 #include <cmath>
-#include "Entity.h"
+#include <vector>
+#include <cstdint>
+#include "EntityManager.h"
 #include "Components.h"
 #include "Vec2.h"
 
 namespace Physics
 {
-    Vec2 getOverlap(std::shared_ptr<Entity> a, std::shared_ptr<Entity> b);
-    Vec2 getPreviousOverlap(std::shared_ptr<Entity> a, std::shared_ptr<Entity> b);
+    Vec2 getOverlap(const Entity& a, const Entity& b);
+    Vec2 getPreviousOverlap(const Entity& a, const Entity& b);
 
-    bool isCollision(std::shared_ptr<Entity> a, std::shared_ptr<Entity> b);
+    bool isCollision(const Entity& a, const Entity& b);
     bool isCollision(Vec2 overlap);
+
+    // First contact of a box moving in a straight line against a static box
+    struct Sweep
+    {
+        bool    hit     = false;    // boxes overlap at some time during the movement, having not at its start
+        float   time    = 1;        // fraction of the movement at first contact
+        Vec2    normal;             // side of the static box that was hit (-1, 0 = left, 0, -1 = top)
+    };
+
+    // Swept AABB test on the Minkowski sum of the two boxes, exact at any speed
+    Sweep sweep(const Vec2& from, const Vec2& to, const Vec2& halfSize, const Vec2& staticPos, const Vec2& staticHalfSize);
+
+    // Sweeps a from its prevPos to its pos against b, which does not move
+    Sweep sweep(const Entity& a, const Entity& b);
+
+    // Overlap of a with b along the normal of a sweep, measured from the side of b that a hit.
+    // Unlike getOverlap it keeps growing once a has moved past b's center
+    Vec2 getSweptOverlap(const Entity& a, const Entity& b, const Sweep& sweep);
+
+    // Boxes packed as separate arrays of positions and half sizes, to test one box against many
+    struct BoxBatch
+    {
+        std::vector<float>  x, y, halfX, halfY;
+
+        void   clear();
+        void   add(const Vec2& pos, const Vec2& halfSize);
+        size_t size() const;
+    };
+
+    // Results of getOverlaps, one entry per box of the batch
+    struct Overlaps
+    {
+        std::vector<float>      x, y;
+        std::vector<uint64_t>   hits;       // bit i is set if isCollision() holds for box i
+
+        bool hit(size_t i) const        {return (hits[i / 64] >> (i % 64)) & 1;}
+        Vec2 overlap(size_t i) const    {return Vec2(x[i], y[i]);}
+    };
+
+    // Overlap of one box with every box of the batch, equal to getOverlap() for each pair.
+    // Four boxes per instruction with SSE2, one at a time where it is not available
+    void getOverlaps(const Vec2& pos, const Vec2& halfSize, const BoxBatch& batch, Overlaps& out);
 };
\ No newline at end of file
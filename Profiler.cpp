@@ -0,0 +1,104 @@
+#include "Profiler.h"
+#include <iostream>
+#include <algorithm>
+
+Profiler::Profiler(size_t capacity)
+    : m_frames(std::max((size_t)1, capacity))
+{}
+
+Profiler::~Profiler()
+{
+    if (m_unwritten) {writeFrame();}
+}
+
+size_t Profiler::addSection(const std::string& name)
+{
+    if (m_sectionNames.size() == MAX_SECTIONS) {std::cerr << "Too many profiler sections: " << name << std::endl; return MAX_SECTIONS - 1;}
+
+    m_sectionNames.push_back(name);
+    return m_sectionNames.size() - 1;
+}
+
+size_t Profiler::addCounter(const std::string& name)
+{
+    if (m_counterNames.size() == MAX_COUNTERS) {std::cerr << "Too many profiler counters: " << name << std::endl; return MAX_COUNTERS - 1;}
+
+    m_counterNames.push_back(name);
+    return m_counterNames.size() - 1;
+}
+
+void Profiler::beginFrame(size_t frame)
+{
+    if (m_unwritten) {writeFrame();}
+    m_unwritten = m_csv.is_open();
+
+    // The first frame goes into slot 0, after that the oldest frame is overwritten
+    if (m_count > 0) {m_head = (m_head + 1) % m_frames.size();}
+    m_count = std::min(m_count + 1, m_frames.size());
+
+    m_frames[m_head] = FrameStats();
+    m_frames[m_head].frame = frame;
+}
+
+void Profiler::writeFrame()
+{
+    auto& stats = m_frames[m_head];
+    m_csv << stats.frame;
+    for (size_t i = 0; i < m_sectionNames.size(); i++) {m_csv << ',' << stats.times[i];}
+    for (size_t i = 0; i < m_counterNames.size(); i++) {m_csv << ',' << stats.counters[i];}
+    m_csv << '\n';
+    m_unwritten = false;
+}
+
+void Profiler::addTime(size_t section, float milliseconds)
+{
+    m_frames[m_head].times[section] += milliseconds;
+}
+
+void Profiler::setCounter(size_t counter, size_t value)
+{
+    m_frames[m_head].counters[counter] = value;
+}
+
+// Header row: frame, one "<section>_ms" column per section, one column per counter
+bool Profiler::openCSV(const std::string& path)
+{
+    m_csv.open(path);
+    if (!m_csv) {std::cerr << "Could not write profile: " << path << std::endl; return false;}
+
+    m_csv << "frame";
+    for (auto& name : m_sectionNames) {m_csv << ',' << name << "_ms";}
+    for (auto& name : m_counterNames) {m_csv << ',' << name;}
+    m_csv << '\n';
+    return true;
+}
+
+size_t Profiler::frames() const
+{
+    return m_count;
+}
+
+const Profiler::FrameStats& Profiler::frame(size_t age) const
+{
+    return m_frames[(m_head + m_frames.size() - age) % m_frames.size()];
+}
+
+float Profiler::averageTime(size_t section, size_t frames) const
+{
+    frames = std::min(frames, m_count);
+    if (frames == 0) {return 0;}
+
+    float total = 0;
+    for (size_t age = 0; age < frames; age++) {total += frame(age).times[section];}
+    return total / frames;
+}
+
+const std::vector<std::string>& Profiler::sectionNames() const
+{
+    return m_sectionNames;
+}
+
+const std::vector<std::string>& Profiler::counterNames() const
+{
+    return m_counterNames;
+}
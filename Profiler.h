@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fstream>
+
+// Records the wall time of named sections and a few counters for every simulation frame.
+// The last frames are kept in a ring buffer for the overlay, and every frame can also be
+// streamed to a CSV file for offline analysis. A frame's row is written when the next frame
+// begins, so time added after its simulation step (rendering it) is part of the row.
+class Profiler
+{
+public:
+    static const size_t MAX_SECTIONS = 8;
+    static const size_t MAX_COUNTERS = 8;
+
+    struct FrameStats
+    {
+        size_t  frame = 0;
+        float   times[MAX_SECTIONS] = {};       // milliseconds per section
+        size_t  counters[MAX_COUNTERS] = {};
+    };
+
+private:
+    std::vector<std::string>    m_sectionNames;
+    std::vector<std::string>    m_counterNames;
+    std::vector<FrameStats>     m_frames;           // ring buffer, m_head is the current frame
+    size_t                      m_head = 0;
+    size_t                      m_count = 0;        // frames recorded, up to m_frames.size()
+    std::ofstream               m_csv;
+    bool                        m_unwritten = false;    // current frame still has to go to the CSV file
+
+    void writeFrame();
+
+public:
+    Profiler(size_t capacity = 600);
+    ~Profiler();                                    // writes the last frame to the CSV file
+
+    // Sections and counters must be added before the first frame, ids are in order of addition
+    size_t addSection(const std::string& name);
+    size_t addCounter(const std::string& name);
+
+    void beginFrame(size_t frame);                  // writes the previous frame to the CSV file, if open
+    void addTime(size_t section, float milliseconds);
+    void setCounter(size_t counter, size_t value);
+
+    bool openCSV(const std::string& path);
+
+    size_t              frames() const;
+    const FrameStats&   frame(size_t age) const;    // 0 is the current frame
+    float               averageTime(size_t section, size_t frames) const;
+
+    const std::vector<std::string>& sectionNames() const;
+    const std::vector<std::string>& counterNames() const;
+};
+
+// Adds the time from construction to destruction to a Profiler section
+class ScopedTimer
+{
+    Profiler&                               m_profiler;
+    size_t                                  m_section;
+    std::chrono::steady_clock::time_point   m_start;
+
+public:
+    ScopedTimer(Profiler& profiler, size_t section)
+        : m_profiler(profiler)
+        , m_section(section)
+        , m_start(std::chrono::steady_clock::now())
+    {}
+
+    ~ScopedTimer()
+    {
+        std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - m_start;
+        m_profiler.addTime(m_section, elapsed.count());
+    }
+};
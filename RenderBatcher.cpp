@@ -0,0 +1,81 @@
+#include "RenderBatcher.h"
+
+RenderBatcher::RenderBatcher() {}
+
+void RenderBatcher::begin()
+{
+    m_vertices.clear();
+    m_batches.clear();
+    m_quadsWritten = 0;
+}
+
+void RenderBatcher::add(size_t index, const sf::Texture* texture, const sf::IntRect& rect, const Vec2& pos, const Vec2& scale, float angle)
+{
+    if (index >= m_slots.size()) {m_slots.resize(index + 1);}
+    auto& slot = m_slots[index];
+
+    // A slot reused by another entity is only rewritten if that entity looks different
+    if (!slot.valid || slot.rect != rect || slot.pos != pos || slot.scale != scale || slot.angle != angle)
+    {
+        slot.rect   = rect;
+        slot.pos    = pos;
+        slot.scale  = scale;
+        slot.angle  = angle;
+        slot.valid  = true;
+        writeQuad(slot);
+    }
+
+    if (m_batches.empty() || m_batches.back().texture != texture)
+    {
+        Batch batch;
+        batch.texture = texture;
+        batch.first   = m_vertices.size();
+        m_batches.push_back(batch);
+    }
+
+    m_vertices.insert(m_vertices.end(), slot.quad, slot.quad + 4);
+    m_batches.back().count += 4;
+}
+
+void RenderBatcher::draw(sf::RenderTarget& target) const
+{
+    for (auto& batch : m_batches)
+    {
+        // Atlas pages that are not resident yet would draw as untextured quads
+        if (batch.texture && batch.texture->getSize().x == 0) {continue;}
+        target.draw(&m_vertices[batch.first], batch.count, sf::Quads, sf::RenderStates(batch.texture));
+    }
+}
+
+void RenderBatcher::writeQuad(Slot& slot)
+{
+    float left   = (float)slot.rect.left;
+    float top    = (float)slot.rect.top;
+    float width  = (float)slot.rect.width;
+    float height = (float)slot.rect.height;
+
+    // Same transform sf::Sprite would apply: position, rotation, scale around the frame's center
+    sf::Transform transform;
+    transform.translate(slot.pos.x, slot.pos.y);
+    transform.rotate(slot.angle);
+    transform.scale(slot.scale.x, slot.scale.y);
+    transform.translate(-width / 2.0f, -height / 2.0f);
+
+    sf::Vertex* quad = slot.quad;
+    quad[0] = sf::Vertex(transform.transformPoint(0, 0),          sf::Vector2f(left,         top));
+    quad[1] = sf::Vertex(transform.transformPoint(width, 0),      sf::Vector2f(left + width, top));
+    quad[2] = sf::Vertex(transform.transformPoint(width, height), sf::Vector2f(left + width, top + height));
+    quad[3] = sf::Vertex(transform.transformPoint(0, height),     sf::Vector2f(left,         top + height));
+
+    m_quadsWritten++;
+}
+
+size_t RenderBatcher::drawCalls() const
+{
+    return m_batches.size();
+}
+
+size_t RenderBatcher::quadsWritten() const
+{
+    return m_quadsWritten;
+}
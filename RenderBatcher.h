@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+#include <SFML/Graphics.hpp>
+#include "Vec2.h"
+
+// Collects sprites into one vertex array, drawn with one call per run of consecutive sprites
+// sharing a texture, so sprites keep the order they were added in. Each entity slot caches its
+// transformed quad, which is only recomputed when the entity's texture rect or transform changed
+// since the previous frame; unchanged sprites cost a comparison and a copy of four vertices.
+class RenderBatcher
+{
+    struct Slot
+    {
+        sf::IntRect rect;
+        Vec2        pos;
+        Vec2        scale;
+        float       angle       = 0;
+        bool        valid       = false;    // quad matches the fields above
+        sf::Vertex  quad[4];
+    };
+
+    struct Batch
+    {
+        const sf::Texture*  texture = nullptr;
+        size_t              first   = 0;        // vertex range in m_vertices
+        size_t              count   = 0;
+    };
+
+    std::vector<Slot>       m_slots;        // indexed by entity slot
+    std::vector<sf::Vertex> m_vertices;     // quads of this frame, in the order they were added
+    std::vector<Batch>      m_batches;
+    size_t                  m_quadsWritten = 0;
+
+    void writeQuad(Slot& slot);
+
+public:
+    RenderBatcher();
+
+    void begin();
+    void add(size_t slot, const sf::Texture* texture, const sf::IntRect& rect, const Vec2& pos, const Vec2& scale, float angle);
+    void draw(sf::RenderTarget& target) const;
+
+    size_t drawCalls() const;
+    size_t quadsWritten() const;    // quads recomputed in the last frame, static entities cost nothing
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <SFML/Graphics.hpp>
+#include "Vec2.h"
+
+// Everything the render thread needs to draw one simulated frame, copied out of the scene so the
+// simulation can move on while it is drawn. World positions are kept for the previous and the
+// current frame, the render thread interpolates between them. Sprites and texts only point at
+// textures and fonts owned by Assets, which outlive every scene.
+struct RenderSnapshot
+{
+    struct Sprite
+    {
+        size_t      slot;               // entity slot, keys the sprite's quad in the RenderBatcher
+        const sf::Texture*  texture;    // atlas page and frame of the animation
+        sf::IntRect         rect;
+        Vec2        prevPos, pos;
+        Vec2        scale;
+        float       angle;
+    };
+
+    struct Box
+    {
+        Vec2        prevPos, pos;
+        Vec2        size;
+    };
+
+    struct Rect
+    {
+        Vec2        pos, size;          // screen space
+        sf::Color   color;
+    };
+
+    struct Text
+    {
+        std::string     string;
+        const sf::Font* font;
+        unsigned        characterSize;
+        sf::Color       color;
+        Vec2            pos;            // screen space
+    };
+
+    size_t              scene = 0;          // changes with the scene, the renderer drops its cached quads
+    size_t              frame = 0;          // simulation frame the snapshot was taken after
+    Vec2                size;               // window size in pixels
+    sf::Color           clearColor;
+    Vec2                prevViewCenter, viewCenter;
+    std::vector<Sprite> sprites;            // world space, in draw order
+    std::vector<Box>    boxes;              // world space collision outlines, drawn over the sprites
+    std::vector<Rect>   rects;              // screen space, filled, drawn over the world
+    std::vector<Text>   texts;              // screen space, drawn last
+
+    std::chrono::steady_clock::time_point   time;           // when it was published
+    std::chrono::nanoseconds                tick = {};      // time until the next one is due
+
+    // Empties the lists, keeping their memory for the next frame
+    void clear()
+    {
+        sprites.clear();
+        boxes.clear();
+        rects.clear();
+        texts.clear();
+    }
+};
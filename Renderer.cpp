@@ -0,0 +1,155 @@
+#include "Renderer.h"
+#include <algorithm>
+
+Renderer::Renderer(sf::RenderWindow& window, Assets& assets)
+    : m_window(window)
+    , m_assets(assets)
+{
+    m_box.setFillColor(sf::Color(0, 0, 0, 0));
+    m_box.setOutlineColor(sf::Color(255, 255, 255, 255));
+    m_box.setOutlineThickness(1);
+}
+
+Renderer::~Renderer()
+{
+    stop();
+}
+
+void Renderer::start()
+{
+    if (m_running) {return;}
+
+    // The context can only be active on one thread at a time
+    m_window.setActive(false);
+    m_running = true;
+    m_thread = std::thread(&Renderer::loop, this);
+}
+
+void Renderer::stop()
+{
+    if (!m_running) {return;}
+
+    m_running = false;
+    m_thread.join();
+    m_window.setActive(true);
+}
+
+RenderSnapshot& Renderer::beginSnapshot()
+{
+    auto& snapshot = m_snapshots.back();
+    snapshot.clear();
+    return snapshot;
+}
+
+void Renderer::publish(std::chrono::nanoseconds tick)
+{
+    auto& snapshot = m_snapshots.back();
+    snapshot.time = std::chrono::steady_clock::now();
+    snapshot.tick = tick;
+    m_snapshots.publish();
+}
+
+size_t Renderer::drawCalls() const
+{
+    return m_drawCalls;
+}
+
+void Renderer::loop()
+{
+    m_window.setActive(true);
+
+    bool published = false;
+    bool settled = false;       // the front snapshot has been drawn at its current positions
+
+    while (m_running)
+    {
+        m_assets.updateResidency();
+
+        if (m_snapshots.acquire())
+        {
+            published = true;
+            settled = false;
+        }
+
+        // Nothing new to show, wait for the simulation instead of redrawing the same frame
+        if (!published || settled)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        auto& snapshot = m_snapshots.front();
+        float alpha = 1;
+        if (snapshot.tick.count() > 0)
+        {
+            alpha = std::chrono::duration<float>(std::chrono::steady_clock::now() - snapshot.time) / snapshot.tick;
+            alpha = std::min(alpha, 1.0f);
+        }
+        settled = alpha >= 1;
+
+        draw(snapshot, alpha);
+        m_window.display();
+    }
+
+    m_window.setActive(false);
+}
+
+static Vec2 interpolate(const Vec2& from, const Vec2& to, float alpha)
+{
+    return from + (to - from) * alpha;
+}
+
+void Renderer::draw(const RenderSnapshot& snapshot, float alpha)
+{
+    // Cached quads are keyed by entity slot, which hold other entities in a new scene
+    if (snapshot.scene != m_scene)
+    {
+        m_batcher = RenderBatcher();
+        m_scene = snapshot.scene;
+    }
+
+    m_window.clear(snapshot.clearColor);
+
+    // World space
+    sf::View view(sf::FloatRect(0, 0, snapshot.size.x, snapshot.size.y));
+    Vec2 center = interpolate(snapshot.prevViewCenter, snapshot.viewCenter, alpha);
+    view.setCenter(center.x, center.y);
+    m_window.setView(view);
+
+    m_batcher.begin();
+    for (auto& sprite : snapshot.sprites)
+    {
+        m_batcher.add(sprite.slot, sprite.texture, sprite.rect, interpolate(sprite.prevPos, sprite.pos, alpha), sprite.scale, sprite.angle);
+    }
+    m_batcher.draw(m_window);
+    m_drawCalls = m_batcher.drawCalls();
+
+    for (auto& box : snapshot.boxes)
+    {
+        Vec2 pos = interpolate(box.prevPos, box.pos, alpha);
+        m_box.setSize(sf::Vector2f(box.size.x - 1, box.size.y - 1));
+        m_box.setOrigin(sf::Vector2f(box.size.x / 2, box.size.y / 2));
+        m_box.setPosition(pos.x, pos.y);
+        m_window.draw(m_box);
+    }
+
+    // Screen space
+    m_window.setView(sf::View(sf::FloatRect(0, 0, snapshot.size.x, snapshot.size.y)));
+    for (auto& rect : snapshot.rects)
+    {
+        m_rect.setSize(sf::Vector2f(rect.size.x, rect.size.y));
+        m_rect.setPosition(rect.pos.x, rect.pos.y);
+        m_rect.setFillColor(rect.color);
+        m_window.draw(m_rect);
+    }
+
+    for (auto& text : snapshot.texts)
+    {
+        m_text.setFont(*text.font);
+        m_text.setCharacterSize(text.characterSize);
+        m_text.setString(text.string);
+        m_text.setFillColor(text.color);
+        m_text.setPosition(text.pos.x, text.pos.y);
+        m_window.draw(m_text);
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <thread>
+#include <atomic>
+#include <SFML/Graphics.hpp>
+#include "RenderBatcher.h"
+#include "RenderSnapshot.h"
+#include "TripleBuffer.h"
+#include "Assets.h"
+
+// Draws the window on its own thread from snapshots published by the simulation thread, so
+// the display rate does not depend on how long a simulation step takes. Between two snapshots
+// entities are drawn at positions interpolated from their previous to their current one by the
+// time elapsed since the last snapshot was published. The window's OpenGL context belongs to
+// the render thread while it runs, so nothing else may draw to the window, and the render thread
+// is the one uploading and unloading the assets' textures.
+class Renderer
+{
+    sf::RenderWindow&               m_window;
+    Assets&                         m_assets;
+    TripleBuffer<RenderSnapshot>    m_snapshots;
+    RenderBatcher                   m_batcher;          // only used on the render thread
+    size_t                          m_scene = 0;        // scene of the batcher's quads
+    sf::Text                        m_text;
+    sf::RectangleShape              m_box;
+    sf::RectangleShape              m_rect;
+    std::thread                     m_thread;
+    std::atomic<bool>               m_running = {false};
+    std::atomic<size_t>             m_drawCalls = {0};
+
+    void loop();
+    void draw(const RenderSnapshot& snapshot, float alpha);
+
+public:
+    Renderer(sf::RenderWindow& window, Assets& assets);
+    ~Renderer();
+
+    void start();
+    void stop();
+
+    // Simulation thread: fill the snapshot returned by beginSnapshot, then publish it
+    RenderSnapshot& beginSnapshot();
+    void            publish(std::chrono::nanoseconds tick);
+
+    size_t drawCalls() const;   // of the last frame drawn
+};
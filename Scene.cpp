@@ -0,0 +1,56 @@
+#include "Scene.h"
+#include "GameEngine.h"
+
+Scene::Scene()
+{
+    m_actionMap.fill(Action::NONE);
+}
+
+Scene::Scene(GameEngine* gameEngine)
+    : m_game(gameEngine)
+{
+    m_actionMap.fill(Action::NONE);
+}
+
+void Scene::registerAction(int inputKey, uint8_t action)
+{
+    if (inputKey >= 0 && inputKey < (int)m_actionMap.size()) {m_actionMap[inputKey] = action;}
+}
+
+uint8_t Scene::actionFor(int inputKey) const
+{
+    if (inputKey < 0 || inputKey >= (int)m_actionMap.size()) {return Action::NONE;}
+    return m_actionMap[inputKey];
+}
+
+// Advance the scene by a number of fixed timesteps without rendering
+void Scene::simulate(const size_t frames)
+{
+    for (size_t i = 0; i < frames && m_game->isRunning(); i++)
+    {
+        m_game->sReplayInput(*this);
+        step();
+        m_game->sStateHash(*this);
+        m_currentFrame++;
+    }
+}
+
+size_t Scene::width() const
+{
+    return m_game->width();
+}
+
+size_t Scene::height() const
+{
+    return m_game->height();
+}
+
+size_t Scene::currentFrame() const
+{
+    return m_currentFrame;
+}
+
+uint64_t Scene::stateHash()
+{
+    return m_entityManager.stateHash();
+}
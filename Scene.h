@@ -2,11 +2,15 @@
 
 #include "Action.h"
 #include "EntityManager.h"
+#include "RenderSnapshot.h"
 #include <memory>
+#include <array>
+#include <SFML/Window.hpp>
 
 class GameEngine;
 
-typedef std::map<int, std::string> ActionMap;
+// Flat key -> action id table, Action::NONE for unbound keys
+typedef std::array<uint8_t, sf::Keyboard::KeyCount> ActionMap;
 
 class Scene
 {
@@ -19,22 +23,29 @@ protected:
     size_t          m_currentFrame = 0;
 
     virtual void onEnd() = 0;
+    virtual void step() = 0;     // one fixed timestep of simulation, no rendering
     void setPaused(bool paused) {m_paused = paused;}
+    void registerAction(int inputKey, uint8_t action);
 
 public:
     Scene();
-    Scene(GameEngine* gameEngine) : m_game(gameEngine) {}
+    Scene(GameEngine* gameEngine);
 
-    virtual void update() = 0;
+    virtual void update() = 0;   // simulates the frames of one tick
     virtual void sDoAction(const Action& action) = 0;
-    virtual void sRender() = 0;
+
+    // Fills the snapshot with what the scene looks like after the last update, on the simulation thread
+    virtual void sRender(RenderSnapshot& snapshot) = 0;
 
     //virtual void doAction(const Action& action);
     void simulate(const size_t frames);
-    //void registerAction(int inputKey, const std::string& actionName);
     ActionMap& getActionMap() {return m_actionMap;}
 
+    // Action bound to a key, Action::NONE if there is none
+    uint8_t actionFor(int inputKey) const;
+
     size_t width() const;
     size_t height() const;
     size_t currentFrame() const;
+    uint64_t stateHash();
 };
\ No newline at end of file
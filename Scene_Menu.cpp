@@ -15,30 +15,26 @@ void Scene_Menu::init()
     m_menuStrings.push_back("Level  2");
     m_menuStrings.push_back("Level  3");
     
-    m_menuText.setFont(m_game->assets().getFont("Megaman"));
-    m_menuText.setCharacterSize(64);
-    
     // set path to level config files
     m_levelPaths.push_back("bin/level1.txt");
     m_levelPaths.push_back("bin/level2.txt");
     m_levelPaths.push_back("bin/level3.txt");
 
     // bind keys for navigating menu
-    registerAction(sf::Keyboard::Escape,"QUIT");
-    registerAction(sf::Keyboard::Up,    "UP");      // move up in menu (looping)
-    registerAction(sf::Keyboard::Down,  "DOWN");    // move down in menu (looping)
-    registerAction(sf::Keyboard::Enter, "PLAY");    // select level and play
+    registerAction(sf::Keyboard::Escape,QUIT);
+    registerAction(sf::Keyboard::Up,    UP);        // move up in menu (looping)
+    registerAction(sf::Keyboard::Down,  DOWN);      // move down in menu (looping)
+    registerAction(sf::Keyboard::Enter, PLAY);      // select level and play
 }
 
-void Scene_Menu::registerAction(int inputKey, const std::string& actionName)
+void Scene_Menu::update()
 {
-    m_actionMap[inputKey] = actionName;
+    simulate(1);
 }
 
-void Scene_Menu::update()
+void Scene_Menu::step()
 {
     m_entityManager.update();
-    sRender();
 }
 
 void Scene_Menu::onEnd()
@@ -48,51 +44,55 @@ void Scene_Menu::onEnd()
 
 void Scene_Menu::sDoAction(const Action& action)
 {
-    if (action.type() == "START")
+    if (!action.start()) {return;}
+
+    switch (action.id())
     {
-        if (action.name() == "UP")
-        {
+        case UP:
             if (m_selectedMenuIndex > 0) {m_selectedMenuIndex--;}
             else {m_selectedMenuIndex = m_menuStrings.size() - 1;}
-        }
-        else if (action.name() == "DOWN")
-        {
+            break;
+
+        case DOWN:
             m_selectedMenuIndex = (m_selectedMenuIndex + 1) % m_menuStrings.size();
-        }
-        else if (action.name() == "PLAY")
-        {
-            std::cout << "PLAY! " << m_levelPaths[m_selectedMenuIndex] << std::endl;
+            break;
 
+        case PLAY:
+            if (!m_game->assets().isLoaded()) {break;}
+            std::cout << "PLAY! " << m_levelPaths[m_selectedMenuIndex] << std::endl;
             m_game->changeScene("PLAY", std::make_shared<Scene_Play>(m_game, m_levelPaths[m_selectedMenuIndex]));
-        }
-        else if (action.name() == "QUIT")
-        {
+            break;
+
+        case QUIT:
             onEnd();
-        }
+            break;
     }
 }
 
-void Scene_Menu::sRender()
+void Scene_Menu::sRender(RenderSnapshot& snapshot)
 {
     // clear the window to a blue
-    m_game->window().setView(m_game->window().getDefaultView());
-    m_game->window().clear(sf::Color(100, 100, 255));
+    snapshot.clearColor = sf::Color(100, 100, 255);
+
+    // show a progress bar instead of the menu until all assets are loaded, and no text before the fonts are
+    auto& assets = m_game->assets();
+    if (!assets.isLoaded())
+    {
+        float barWidth = snapshot.size.x - 20;
+        snapshot.rects.push_back({Vec2(10, 110), Vec2(barWidth, 24), sf::Color(0, 0, 0)});
+        snapshot.rects.push_back({Vec2(10, 110), Vec2(barWidth * assets.progress(), 24), sf::Color::White});
+    }
+    if (!assets.fontsLoaded()) {return;}
+    if (!m_font) {m_font = &assets.getFont("Megaman");}
 
     // draw the game title in the top-left of the screen
-    m_menuText.setCharacterSize(48);
-    m_menuText.setString(m_title);
-    m_menuText.setFillColor(sf::Color::Black);
-    m_menuText.setPosition(sf::Vector2f(10, 10));
-    m_game->window().draw(m_menuText);
+    snapshot.texts.push_back({m_title, m_font, 48, sf::Color::Black, Vec2(10, 10)});
+    if (!assets.isLoaded()) {return;}
 
     // draw all of the menu options
     for (size_t i = 0; i < m_menuStrings.size(); i++)
     {
-        m_menuText.setString(m_menuStrings[i]);
-        m_menuText.setFillColor(i == m_selectedMenuIndex ? sf::Color::White : sf::Color(0, 0, 0));
-        m_menuText.setPosition(sf::Vector2f(10, 110 + i * 72));
-        m_game->window().draw(m_menuText);
+        sf::Color color = i == m_selectedMenuIndex ? sf::Color::White : sf::Color(0, 0, 0);
+        snapshot.texts.push_back({m_menuStrings[i], m_font, 48, color, Vec2(10, 110 + i * 72)});
     }
-
-    m_game->window().display();
 }
\ No newline at end of file
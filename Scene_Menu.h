@@ -12,20 +12,22 @@
 class Scene_Menu : public Scene
 {
 protected:
+    enum Actions : uint8_t { QUIT, UP, DOWN, PLAY };
+
     std::string                 m_title;
     std::vector<std::string>    m_menuStrings;
     std::vector<std::string>    m_levelPaths;
-    sf::Text                    m_menuText;
+    const sf::Font*             m_font = nullptr;
     size_t                      m_selectedMenuIndex = 0;
 
     void init();
-    void registerAction(int inputKey, const std::string& actionName);
 
     void update();
+    void step();
     void onEnd();
 
     void sDoAction(const Action& action);
-    void sRender();
+    void sRender(RenderSnapshot& snapshot);
 
 public:
     Scene_Menu(GameEngine* gameEngine = nullptr);
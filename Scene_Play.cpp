@@ -1,4 +1,5 @@
 #include "Scene_Play.h"
+#include <cstdio>
 
 Scene_Play::Scene_Play(GameEngine* gameEngine, const std::string& levelPath)
     : Scene(gameEngine)
@@ -10,457 +11,721 @@ Scene_Play::Scene_Play(GameEngine* gameEngine, const std::string& levelPath)
 void Scene_Play::init(const std::string& levelPath)
 {
     // Bind keys for game play and debugging options
-    registerAction(sf::Keyboard::P,     "PAUSE");
-    registerAction(sf::Keyboard::Escape,"QUIT");
-    registerAction(sf::Keyboard::T,     "TOGGLE_TEXTURE");      // toggle drawing (T)extures
-    registerAction(sf::Keyboard::C,     "TOGGLE_COLLISION");    // toggle drawing (C)ollision Boxes
-    registerAction(sf::Keyboard::G,     "TOGGLE_GRID");         // toggle drawing (G)rid
+    registerAction(sf::Keyboard::P,     PAUSE);
+    registerAction(sf::Keyboard::Escape,QUIT);
+    registerAction(sf::Keyboard::T,     TOGGLE_TEXTURE);        // toggle drawing (T)extures
+    registerAction(sf::Keyboard::C,     TOGGLE_COLLISION);      // toggle drawing (C)ollision Boxes
+    registerAction(sf::Keyboard::G,     TOGGLE_GRID);           // toggle drawing (G)rid
+    registerAction(sf::Keyboard::F,     TOGGLE_PROFILER);       // toggle drawing (F)rame profiler
 
     // Bind keys for player movement and actions
-    registerAction(sf::Keyboard::Left,  "LEFT");                // player moves LEFT
-    registerAction(sf::Keyboard::Right, "RIGHT");               // player moves RIGHT
-    registerAction(sf::Keyboard::Space, "JUMP");                // player JUMPs
-    registerAction(sf::Keyboard::Up,    "JUMP");                // player JUMPs
-    registerAction(sf::Keyboard::A,     "SHOOT");               // player SHOOTs
+    registerAction(sf::Keyboard::Left,  LEFT);                  // player moves LEFT
+    registerAction(sf::Keyboard::Right, RIGHT);                 // player moves RIGHT
+    registerAction(sf::Keyboard::Space, JUMP);                  // player JUMPs
+    registerAction(sf::Keyboard::Up,    JUMP);                  // player JUMPs
+    registerAction(sf::Keyboard::A,     SHOOT);                 // player SHOOTs
 
     // Init text for debugging grid
     m_gridText.setCharacterSize(12);
     m_gridText.setFont(m_game->assets().getFont("Arial"));
 
+    // Profile every system of a step, plus rendering
+    m_profiler.addSection("entities");
+    m_profiler.addSection("movement");
+    m_profiler.addSection("collision");
+    m_profiler.addSection("lifespan");
+    m_profiler.addSection("animation");
+    m_profiler.addSection("render");
+    m_profiler.addCounter("entities");
+    m_profiler.addCounter("pair_tests");
+    m_profiler.addCounter("draw_calls");
+    if (!m_game->profilePath().empty()) {m_profiler.openCSV(m_game->profilePath());}
+
+    // Systems of a step, in serial order. Movement and the lifespan countdown touch disjoint
+    // components and run at the same time, entities are only destroyed after collisions
+    const uint32_t EXCLUSIVE = SystemScheduler::EXCLUSIVE;
+    m_systems.add(EXCLUSIVE, EXCLUSIVE, [this] {ScopedTimer timer(m_profiler, SECTION_MOVEMENT);  sPlayerInput();});
+    m_systems.add(componentMask<CGravity>(), componentMask<CTransform>() | SPATIAL_GRIDS, [this] {ScopedTimer timer(m_profiler, SECTION_MOVEMENT);  sMovement();});
+    m_systems.add(0, componentMask<CLifespan>(), [this] {ScopedTimer timer(m_profiler, SECTION_LIFESPAN);  sLifespan();});
+    m_systems.add(EXCLUSIVE, EXCLUSIVE, [this] {ScopedTimer timer(m_profiler, SECTION_COLLISION); sCollision();});
+    m_systems.add(EXCLUSIVE, EXCLUSIVE, [this] {ScopedTimer timer(m_profiler, SECTION_LIFESPAN);  sExpire();});
+    m_systems.add(EXCLUSIVE, EXCLUSIVE, [this] {ScopedTimer timer(m_profiler, SECTION_ANIMATION); sAnimation();});
+
     // Load level from the level file
-    loadLevel(levelPath);
+    m_levelLoaded = loadLevel(levelPath);
 }
 
-void Scene_Play::registerAction(sf::Keyboard::Key input, std::string actionName)
+// Reads a text or compiled binary level file, then spawns it. Returns false, spawning nothing,
+// if the file cannot be read, has no player or names animations missing from the assets
+bool Scene_Play::loadLevel(const std::string& filename)
 {
-    m_actionMap[input] = actionName;
+    if (!m_levelData.load(filename)) {std::cerr << "Could not load level: " << filename << std::endl; return false;}
+    if (m_levelData.playerIndex == LevelData::NO_PLAYER) {std::cerr << "Level has no Player: " << filename << std::endl; return false;}
+
+    m_playerConfig = m_levelData.player;
+    m_weaponConfig = m_levelData.weapon;
+
+    // The player needs a character, a weapon is optional but must exist if the level names one
+    auto& assets = m_game->assets();
+    std::vector<std::string> names = m_levelData.animations;
+    names.push_back(m_playerConfig.CHARACTER);
+    if (m_levelData.hasWeapon) {names.push_back(m_weaponConfig.WEAPON);}
+    for (auto& name : names)
+    {
+        if (assets.findAnimationId(name) == AnimationClip::NO_ID) {std::cerr << "Unknown animation '" << name << "' in " << filename << std::endl; return false;}
+    }
+
+    m_anim.stand        = assets.getAnimationId("Stand");
+    m_anim.run          = assets.getAnimationId("Run");
+    m_anim.air          = assets.getAnimationId("Air");
+    m_anim.character    = assets.findAnimationId(m_playerConfig.CHARACTER);
+    m_anim.weapon       = m_levelData.hasWeapon ? assets.findAnimationId(m_weaponConfig.WEAPON) : AnimationClip::NO_ID;
+    m_anim.question     = assets.getAnimationId("Question");
+    m_anim.question2    = assets.getAnimationId("Question2");
+    m_anim.brick        = assets.getAnimationId("Brick");
+    m_anim.explosion    = assets.getAnimationId("Explosion");
+    m_anim.coin         = assets.getAnimationId("Coin");
+
+    // Keep every texture the level can show resident while it runs
+    std::vector<TextureHandle> textures;
+    for (auto& name : m_levelData.animations) {textures.push_back(assets.acquire(assets.getAnimationId(name)));}
+    for (auto id : {m_anim.stand, m_anim.run, m_anim.air, m_anim.character, m_anim.weapon,
+                    m_anim.question, m_anim.question2, m_anim.brick, m_anim.explosion, m_anim.coin})
+    {
+        if (id != AnimationClip::NO_ID) {textures.push_back(assets.acquire(id));}
+    }
+    m_textures.swap(textures);
+
+    // Level tiles loop in step, so each of their clips only advances once per frame
+    m_clock.clear();
+    for (auto& name : m_levelData.animations) {m_clock.add(assets.getAnimation(name));}
+    m_clock.add(assets.getAnimation(m_anim.question2));
+
+    spawnLevel();
+    return true;
 }
 
-void Scene_Play::loadLevel(const std::string& filename)
+// Instantiates every entity of m_levelData in one pass, in level file order
+void Scene_Play::spawnLevel()
 {
-    // reset the entity manager whenever level is loaded
-    m_entityManager = EntityManager();
+    // reset the entity manager whenever level is loaded, broadphase cells match the level grid
+    m_entityManager = EntityManager(m_gridSize);
+    m_tag.tile      = m_entityManager.tagId("tile");
+    m_tag.player    = m_entityManager.tagId("player");
+    m_tag.bullet    = m_entityManager.tagId("bullet");
+    m_entityManager.setStatic(m_tag.tile);
+
+    // Bullets live for LIFESPAN frames, so a shot every frame never needs more slots than this.
+    // Coins and explosions replace Question and Brick tiles and reuse the slots of destroyed ones
+    m_entityManager.reserve(m_tag.bullet, (size_t)m_weaponConfig.LIFESPAN + 1);
+    m_entityManager.reserve(m_tag.tile, 8);
+
+    // Resolve each animation name once per level instead of once per tile
+    std::vector<const AnimationClip*> animations;
+    for (auto& name : m_levelData.animations) {animations.push_back(&m_game->assets().getAnimation(name));}
+
+    // Tiles filling exactly one grid cell collide through the tilemap, larger (pipes) or off-grid ones through the broadphase
+    auto onGrid = [](float value) {return value == std::floor(value) && fabsf(value) < 32768;};
+    auto inTileMap = [&](const LevelData::TileSpec& spec)
+    {
+        return spec.kind == LevelData::TILE && animations[spec.animation]->getSize() == m_gridSize && onGrid(spec.gridX) && onGrid(spec.gridY);
+    };
 
-    std::ifstream fin(filename);
-    std::string temp;
+    int minX = 0, minY = 0, maxX = -1, maxY = -1;
+    for (auto& spec : m_levelData.tiles)
+    {
+        if (!inTileMap(spec)) {continue;}
+        if (maxX < minX) {minX = maxX = spec.gridX; minY = maxY = spec.gridY;}
+        minX = std::min(minX, (int)spec.gridX);
+        minY = std::min(minY, (int)spec.gridY);
+        maxX = std::max(maxX, (int)spec.gridX);
+        maxY = std::max(maxY, (int)spec.gridY);
+    }
+    m_tileMap.reset(m_gridSize, height(), minX, minY, maxX, maxY);
 
-    while (fin >> temp)
+    for (size_t i = 0; i <= m_levelData.tiles.size(); i++)
     {
-        if (temp == "Tile")
-        {
-            
-            std::string animName;
-            float gridX, gridY;
-            fin >> animName >> gridX >> gridY;                      // Animation name, grid position (x,y) = (64 x 64px)
+        if (i == m_levelData.playerIndex) {spawnPlayer();}
+        if (i == m_levelData.tiles.size()) {break;}
 
-            // create tile entity WITH bounding box
-            auto tile = m_entityManager.addEntity("tile");      
+        auto& spec = m_levelData.tiles[i];
+        auto tile = m_entityManager.addEntity(m_tag.tile);
 
-            tile->addComponent<CAnimation>(m_game->assets().getAnimation(animName), true);          
-            tile->addComponent<CBoundingBox>(tile->getComponent<CAnimation>().animation.getSize());
-            tile->addComponent<CTransform>(gridToMidPixel(gridX, gridY, tile));
-        }
-        else if (temp == "Dec")
-        {
-            std::string animName;
-            float gridX, gridY;
-            fin >> animName >> gridX >> gridY;                      // Animation name, grid position (x,y) = (64 x 64px)
-            
-            // create tile entity WITHOUT bounding box
-            auto tile = m_entityManager.addEntity("tile");
-            
-            tile->addComponent<CAnimation>(m_game->assets().getAnimation(animName), true);
-            tile->addComponent<CTransform>(gridToMidPixel(gridX, gridY, tile));
-        }
-        else if (temp == "Player")
+        tile.addComponent<CAnimation>(*animations[spec.animation], true, true);
+
+        // Tile has a bounding box, Dec does not
+        if (spec.kind == LevelData::TILE)
         {
-            fin >> m_playerConfig.CHARACTER                         // Player character texture
-                >> m_playerConfig.X >> m_playerConfig.Y             // Player starting position (x, y)
-                >> m_playerConfig.CX >> m_playerConfig.CY           // Player collision box height, width (x, y)
-                >> m_playerConfig.SPEED >> m_playerConfig.MAXSPEED  // Player horizontal move speed, max speed (counteract huge speeds due to gravity)
-                >> m_playerConfig.JUMP >> m_playerConfig.MAXJUMP    // Player vertical jump speed (-y = up), gravity (+y = down)
-                >> m_playerConfig.GRAVITY;
-            
-            spawnPlayer();
+            tile.addComponent<CBoundingBox>(tile.getComponent<CAnimation>().animation.getSize());
         }
-        else if (temp == "Weapon")
+
+        tile.addComponent<CTransform>(gridToMidPixel(spec.gridX, spec.gridY, tile));    // grid position (x,y) = (64 x 64px)
+
+        // A second tile in an occupied cell keeps colliding through the broadphase, the first keeps the cell
+        if (inTileMap(spec))
         {
-            fin >> m_weaponConfig.WEAPON                            // Weapon bullet texture
-                >> m_weaponConfig.SPEED                             // Bullet speed (pixels/frame)
-                >> m_weaponConfig.LIFESPAN;                         // Bullet lifespan (frames)
+            if (m_tileMap.set((int)spec.gridX, (int)spec.gridY, tile)) {m_entityManager.excludeFromGrid(tile);}
+            else {std::cerr << "Two tiles in grid cell " << spec.gridX << " " << spec.gridY << " of " << m_levelPath << std::endl;}
         }
     }
+
+    // Make the level live, bake tile collision and keep a copy to respawn from
+    m_entityManager.update();
+    m_entityManager.bakeStatic();
+    m_levelSnapshot = m_entityManager.snapshot();
+}
+
+// Puts the level back to how spawnLevel left it, touching only entities changed since then
+void Scene_Play::resetLevel()
+{
+    m_entityManager.restore(m_levelSnapshot);
+    m_player = m_entityManager.rebind(m_player);
+    m_tileMap.rebind(m_entityManager);
 }
 
-Vec2 Scene_Play::gridToMidPixel(float gridX, float gridY, std::shared_ptr<Entity> entity)
+Vec2 Scene_Play::gridToMidPixel(float gridX, float gridY, const Entity& entity)
 {
     // one grid is 64 x 64 pixels, entity center is at offset (x/2, y/2)
-    float x = (gridX * 64) + entity->getComponent<CAnimation>().animation.getSize().x / 2.0f;
-    float y = (gridY * 64) + entity->getComponent<CAnimation>().animation.getSize().y / 2.0f;
+    float x = (gridX * 64) + entity.getComponent<CAnimation>().animation.getSize().x / 2.0f;
+    float y = (gridY * 64) + entity.getComponent<CAnimation>().animation.getSize().y / 2.0f;
 
     // level grid y-axis and window y-axis are inverted
-    y = m_game->window().getSize().y - y;
+    y = height() - y;
 
     return Vec2(x, y);
 }
 
 void Scene_Play::spawnPlayer()
 {
-    auto player = m_entityManager.addEntity("player");
+    auto player = m_entityManager.addEntity(m_tag.player);
 
     // Player properties set based on PlayerConfig struct
-    player->addComponent<CAnimation>(m_game->assets().getAnimation(m_playerConfig.CHARACTER), true);
-    player->addComponent<CBoundingBox>(Vec2(m_playerConfig.CX, m_playerConfig.CY));
-    player->addComponent<CTransform>(   gridToMidPixel(m_playerConfig.X, m_playerConfig.Y, player),
+    player.addComponent<CAnimation>(m_game->assets().getAnimation(m_anim.character), true);
+    player.addComponent<CBoundingBox>(Vec2(m_playerConfig.CX, m_playerConfig.CY));
+    player.addComponent<CTransform>(   gridToMidPixel(m_playerConfig.X, m_playerConfig.Y, player),
                                         Vec2(m_playerConfig.SPEED, m_playerConfig.SPEED),
                                         0.0f);
-    player->addComponent<CGravity>(m_playerConfig.GRAVITY);
-    player->addComponent<CInput>();
-    player->addComponent<CState>();
+    player.addComponent<CGravity>(m_playerConfig.GRAVITY);
+    player.addComponent<CInput>();
+    player.addComponent<CState>();
 
     m_player = player;
 }
 
-void Scene_Play::spawnBullet()
+Entity Scene_Play::spawnBullet()
 {
-    auto bullet = m_entityManager.addEntity("bullet");
+    auto bullet = m_entityManager.addEntity(m_tag.bullet);
 
     // calculate player direction (+: right, -: left)
-    float direction = (m_player->getComponent<CTransform>().scale.x > 0) ? 1 : -1;
+    float direction = (m_player.getComponent<CTransform>().scale.x > 0) ? 1 : -1;
 
     // Player properties set based on WeaponConfig struct
-    auto anim = m_game->assets().getAnimation(m_weaponConfig.WEAPON);
-    bullet->addComponent<CAnimation>(anim, true);
-    bullet->addComponent<CBoundingBox>(Vec2(anim.getSize().x, anim.getSize().y));
-    bullet->addComponent<CTransform>(   Vec2(m_player->getComponent<CTransform>().pos.x + m_player->getComponent<CBoundingBox>().halfSize.x * direction,
-                                             m_player->getComponent<CTransform>().pos.y),
+    auto& anim = m_game->assets().getAnimation(m_anim.weapon);
+    bullet.addComponent<CAnimation>(anim, true);
+    bullet.addComponent<CBoundingBox>(Vec2(anim.getSize().x, anim.getSize().y));
+    bullet.addComponent<CTransform>(   Vec2(m_player.getComponent<CTransform>().pos.x + m_player.getComponent<CBoundingBox>().halfSize.x * direction,
+                                             m_player.getComponent<CTransform>().pos.y),
                                         Vec2(m_weaponConfig.SPEED * direction, 0),
                                         0.0f);
-    bullet->addComponent<CLifespan>(m_weaponConfig.LIFESPAN, m_currentFrame);
+    bullet.addComponent<CLifespan>(m_weaponConfig.LIFESPAN, m_currentFrame);
+
+    return bullet;
 }
 
 void Scene_Play::update()
 {
-    m_entityManager.update();
+    if (!m_levelLoaded) {onEnd(); return;}
 
-    if (!m_paused)
-    {
-        sMovement();
-        sCollision();
-        sLifespan();
-        sAnimation();    
-    }
-    sRender();
+    // Step the simulation m_simulationSpeed times per tick
+    simulate(m_game->simulationSpeed());
+}
+
+void Scene_Play::step()
+{
+    m_profiler.beginFrame(m_currentFrame);
+
+    { ScopedTimer timer(m_profiler, SECTION_ENTITIES); m_entityManager.update(); }
+
+    if (!m_paused) {m_systems.run(m_game->jobs());}
+
+    m_profiler.setCounter(COUNTER_ENTITIES, m_entityManager.getEntities().size());
+    m_profiler.setCounter(COUNTER_PAIR_TESTS, m_pairTests);
 }
 
 void Scene_Play::sDoAction(const Action& action)
 {
-    if (action.type() == "START")
+    if (!m_levelLoaded) {return;}
+
+    auto& input = m_player.getComponent<CInput>();
+
+    if (action.start())
     {
-             if (action.name() == "TOGGLE_TEXTURE")     { m_drawTextures = !m_drawTextures; }
-        else if (action.name() == "TOGGLE_COLLISION")   { m_drawCollision = !m_drawCollision; }
-        else if (action.name() == "TOGGLE_GRID")        { m_drawGrid = !m_drawGrid; }
-        else if (action.name() == "LEFT")               { m_player->getComponent<CInput>().left      = true; }
-        else if (action.name() == "RIGHT")              { m_player->getComponent<CInput>().right     = true; }
-        else if (action.name() == "JUMP")               {
-                                                            if (m_player->getComponent<CInput>().canJump  == true) 
-                                                            {
-                                                                m_player->getComponent<CInput>().canJump   = false;
-                                                                m_player->getComponent<CInput>().up        = true;
-                                                            }
-                                                        }
-        else if (action.name() == "SHOOT")              {
-                                                            if (m_player->getComponent<CInput>().canShoot)
-                                                            {
-                                                                m_player->getComponent<CInput>().shoot = true;
-                                                                m_player->getComponent<CInput>().canShoot  = false;
-                                                            }
-                                                        }
-        else if (action.name() == "QUIT")               { onEnd(); }
-        else if (action.name() == "PAUSE")              { setPaused(!m_paused); }
+        switch (action.id())
+        {
+            case TOGGLE_TEXTURE:    m_drawTextures = !m_drawTextures;   break;
+            case TOGGLE_COLLISION:  m_drawCollision = !m_drawCollision; break;
+            case TOGGLE_GRID:       m_drawGrid = !m_drawGrid;           break;
+            case TOGGLE_PROFILER:   m_drawProfiler = !m_drawProfiler;   break;
+            case LEFT:              input.left      = true;             break;
+            case RIGHT:             input.right     = true;             break;
+            case JUMP:              if (input.canJump  == true) 
+                                    {
+                                        input.canJump   = false;
+                                        input.up        = true;
+                                    }
+                                    break;
+            case SHOOT:             if (input.canShoot)
+                                    {
+                                        input.shoot     = true;
+                                        input.canShoot  = false;
+                                    }
+                                    break;
+            case QUIT:              onEnd();                            break;
+            case PAUSE:             setPaused(!m_paused);               break;
+        }
     }
-    else if (action.type() == "END")
+    else
     {
-             if (action.name() == "LEFT")               { m_player->getComponent<CInput>().left      = false; }
-        else if (action.name() == "RIGHT")              { m_player->getComponent<CInput>().right     = false; }
-        else if (action.name() == "JUMP")               { m_player->getComponent<CInput>().up        = false; }
-        else if (action.name() == "SHOOT")              { m_player->getComponent<CInput>().canShoot  = true; }
+        switch (action.id())
+        {
+            case LEFT:              input.left      = false;            break;
+            case RIGHT:             input.right     = false;            break;
+            case JUMP:              input.up        = false;            break;
+            case SHOOT:             input.canShoot  = true;             break;
+        }
     }
 }
 
-void Scene_Play::sMovement()
+void Scene_Play::sPlayerInput()
 {
     // Set player velocity based on input
-    Vec2 playerVelocity = {0, m_player->getComponent<CTransform>().velocity.y};
+    Vec2 playerVelocity = {0, m_player.getComponent<CTransform>().velocity.y};
 
-    if (m_player->getComponent<CInput>().shoot)     { spawnBullet(); m_player->getComponent<CInput>().shoot =false; }
-    if (m_player->getComponent<CInput>().left)      { playerVelocity.x = -m_playerConfig.SPEED; }
-    if (m_player->getComponent<CInput>().right)     { playerVelocity.x =  m_playerConfig.SPEED; }
-    if (m_player->getComponent<CInput>().up)        {
-                                                        if (m_player->getComponent<CInput>().canJump)
+    if (m_player.getComponent<CInput>().shoot && m_anim.weapon != AnimationClip::NO_ID) { spawnBullet(); m_player.getComponent<CInput>().shoot =false; }
+    if (m_player.getComponent<CInput>().left)      { playerVelocity.x = -m_playerConfig.SPEED; }
+    if (m_player.getComponent<CInput>().right)     { playerVelocity.x =  m_playerConfig.SPEED; }
+    if (m_player.getComponent<CInput>().up)        {
+                                                        if (m_player.getComponent<CInput>().canJump)
                                                         {
-                                                            float& jumpDur = m_player->getComponent<CState>().jumpDuration;
-                                                            if (((jumpDur == 0) && !(m_player->getComponent<CState>().state == "air")) ||   // Check to start jump
-                                                                ((jumpDur > 0) && (jumpDur < m_playerConfig.MAXJUMP) && (m_player->getComponent<CInput>().canJump)))                      // Check to continue jump
+                                                            float& jumpDur = m_player.getComponent<CState>().jumpDuration;
+                                                            if (((jumpDur == 0) && !(m_player.getComponent<CState>().state == CState::AIR)) ||   // Check to start jump
+                                                                ((jumpDur > 0) && (jumpDur < m_playerConfig.MAXJUMP) && (m_player.getComponent<CInput>().canJump)))                      // Check to continue jump
                                                             {
                                                                 playerVelocity.y =  m_playerConfig.JUMP;
-                                                                m_player->getComponent<CState>().jumpDuration += 1;
-                                                                std::cout << "jump: " << jumpDur << "/" << m_playerConfig.MAXJUMP << std::endl;
+                                                                m_player.getComponent<CState>().jumpDuration += 1;
                                                             }
                                                         }
                                                     }
                                                          
-    m_player->getComponent<CTransform>().velocity = playerVelocity;
+    m_player.getComponent<CTransform>().velocity = playerVelocity;
+}
+
+void Scene_Play::sMovement()
+{
+    auto& entities = m_entityManager.getDynamicEntities();
 
-    // Update positions based on velocity
-    for (auto e : m_entityManager.getEntities())
+    // Update positions based on velocity, tiles never move. Nothing caps the speed: sCollision sweeps
+    // fast movers from prevPos to pos, so they cannot pass through tiles between frames
+    m_game->jobs().parallelFor(entities.size(), ENTITY_GRAIN, [&](size_t begin, size_t end)
     {
-        if (e->hasComponent<CGravity>()) 
+        for (size_t i = begin; i < end; i++)
         {
-            // Accelerate down (+y) for gravity, then cap max downward velocity so player doesn't pass through tile bounding boxes
-            e->getComponent<CTransform>().velocity.y += e->getComponent<CGravity>().gravity;
-            e->getComponent<CTransform>().velocity.y  = fminf(e->getComponent<CTransform>().velocity.y, m_playerConfig.MAXSPEED);
+            auto& transform = entities[i].getComponent<CTransform>();
+
+            // Accelerate down (+y) for gravity
+            if (entities[i].hasComponent<CGravity>()) {transform.velocity.y += entities[i].getComponent<CGravity>().gravity;}
+
+            transform.prevPos = transform.pos;
+            transform.pos += transform.velocity;
         }
+    });
 
-        //Vec2& playerVelocity = m_player->getComponent<CTransform>().velocity;
-        //playerVelocity.x = fmin(playerVelocity.x, m_playerConfig.MAXSPEED);
-        //playerVelocity.y = fmin(playerVelocity.y, m_playerConfig.MAXSPEED);
-        
-        e->getComponent<CTransform>().pos += e->getComponent<CTransform>().velocity;
+    // The grids are shared, so moved entities are updated in them on this thread
+    for (auto e : entities)
+    {
+        if (e.getComponent<CTransform>().velocity != Vec2(0, 0)) {m_entityManager.updateSpatial(e);}
     }
 }
 
 void Scene_Play::sCollision()
 {
     // Prevent player from going out of left side of window
-    if (m_player->getComponent<CTransform>().pos.x - m_player->getComponent<CBoundingBox>().halfSize.x < 0)
+    if (m_player.getComponent<CTransform>().pos.x - m_player.getComponent<CBoundingBox>().halfSize.x < 0)
     {
-        m_player->getComponent<CTransform>().pos.x = m_player->getComponent<CBoundingBox>().halfSize.x;
+        m_player.getComponent<CTransform>().pos.x = m_player.getComponent<CBoundingBox>().halfSize.x;
     }
     
-    // Reload level if player has fallen below the screen (dies)
-    if (m_player->getComponent<CTransform>().pos.y + m_player->getComponent<CBoundingBox>().halfSize.y > m_game->window().getSize().y)
+    m_coinPositions.clear();
+    m_pairTests = 0;
+
+    size_t threads = m_game->jobs().workerCount() + 1;
+    if (m_collisionQueries.size() < threads) {m_collisionQueries.resize(threads);}
+
+    // PLAYER & TILES
+    // Broadphase: only tiles in grid cells overlapping the player's movement this frame (prevPos -> pos).
+    // Resolving a collision moves the player back along that path, so tiles clear of the box around it
+    // can never collide, and the previous overlaps do not change while the loop below resolves
+    auto& query = m_collisionQueries[m_game->jobs().threadIndex()];
+    queryTiles(m_player.getComponent<CTransform>(), m_player.getComponent<CBoundingBox>(), query);
+    Physics::getOverlaps(query.sweepPos, query.sweepHalfSize, query.boxes, m_sweepOverlaps);
+    Physics::getOverlaps(m_player.getComponent<CTransform>().prevPos, m_player.getComponent<CBoundingBox>().halfSize, query.boxes, m_previousOverlaps);
+    m_pairTests += query.candidates.size();
+
+    for (size_t i = 0; i < query.candidates.size(); i++)
     {
-        loadLevel(m_levelPath);
-    }
+        if (!m_sweepOverlaps.hit(i)) {continue;}
+        auto tile = query.candidates[i];
 
-    // TILES
-    for (auto tile : m_entityManager.getEntities("tile"))
-    {
-        if (!(tile->hasComponent<CBoundingBox>())) {continue;}
-        
-        // PLAYER & TILES
-            Vec2 overlap          = Physics::getOverlap(m_player, tile);
-            Vec2 previousOverlap  = Physics::getPreviousOverlap(m_player, tile);
+            Vec2 overlap          = Physics::getOverlap(m_player, tile);                // player moves as collisions are resolved
+            Vec2 previousOverlap  = m_previousOverlaps.overlap(i);                      // tiles are static, their prevPos is pos
 
         // typedef for readability
-            auto& playerTransform = m_player->getComponent<CTransform>();
-            auto& tileTransform   = tile->getComponent<CTransform>();
-            auto& tileType = tile->getComponent<CAnimation>().animation.getName();
+            auto& playerTransform = m_player.getComponent<CTransform>();
+            auto& tileTransform   = tile.getComponent<CTransform>();
+            size_t tileType = tile.getComponent<CAnimation>().animation.getId();
 
-        if (Physics::isCollision(overlap))
+        // Side of the tile the player came from
+        bool fromAbove = false, fromBelow = false, fromLeft = false, fromRight = false;
+
+        // A fast mover is resolved against the side it hit first, whether it passed through the tile
+        // or ended inside it. Past the tile's center getOverlap would push it out of the far side
+        auto sweep = isFastMover(m_player) ? Physics::sweep(m_player, tile) : Physics::Sweep();
+
+        if (sweep.hit)
+        {
+            overlap   = Physics::getSweptOverlap(m_player, tile, sweep);
+            fromAbove = sweep.normal.y < 0;
+            fromBelow = sweep.normal.y > 0;
+            fromLeft  = sweep.normal.x < 0;
+            fromRight = sweep.normal.x > 0;
+        }
+        else if (Physics::isCollision(overlap))
+        {
+            fromAbove = previousOverlap.x > 0 && playerTransform.prevPos.y < tileTransform.pos.y;
+            fromBelow = previousOverlap.x > 0 && playerTransform.prevPos.y > tileTransform.pos.y;
+            fromLeft  = previousOverlap.y > 0 && playerTransform.prevPos.x < tileTransform.pos.x;
+            fromRight = previousOverlap.y > 0 && playerTransform.prevPos.x > tileTransform.pos.x;
+        }
+
+        // collide from ABOVE
+        if (fromAbove)
+        {
+            playerTransform.pos.y -= overlap.y;                                                                  // adjust position by overlap
+            playerTransform.velocity.y = 0;                                                                      // adjust velocity = 0
+            m_player.getComponent<CInput>().canJump = true;                                                     // allow next jump
+            m_player.getComponent<CState>().jumpDuration = 0;                                                   // |->  reset jumpDuration
+            m_player.getComponent<CState>().state = (playerTransform.velocity.x != 0) ? CState::RUNNING : CState::STANDING; // set state for animation                
+        }
+        // collide from BELOW
+        else if (fromBelow)
         {
-            // collide from ABOVE
-            if (previousOverlap.x > 0 && playerTransform.prevPos.y < tileTransform.prevPos.y)
+            playerTransform.pos.y += overlap.y;                                                                  // adjust position by overlap
+            playerTransform.velocity.y = 0;                                                                      // adjust velocity = 0
+            m_player.getComponent<CState>().jumpDuration = m_playerConfig.MAXJUMP;                              // stop current jump                   
+            
+            if (tileType == m_anim.question)
             {
-                playerTransform.pos.y -= overlap.y;                                                                  // adjust position by overlap
-                playerTransform.velocity.y = 0;                                                                      // adjust velocity = 0
-                m_player->getComponent<CInput>().canJump = true;                                                     // allow next jump
-                m_player->getComponent<CState>().jumpDuration = 0;                                                   // |->  reset jumpDuration
-                m_player->getComponent<CState>().state = (playerTransform.velocity.x != 0) ? "running" : "standing"; // set state for animation                
+                // Queue a Coin tile one grid (64x64px) above the Question box position (tilePos).
+                // Spawned after the loop because addEntity invalidates the component references above
+                auto tilePos = tile.getComponent<CTransform>().pos;
+                m_coinPositions.push_back(Vec2(tilePos.x, tilePos.y - tile.getComponent<CBoundingBox>().size.y));
+
+                // Change Question box animation from blinking to steady. Won't trigger again because tileType is different
+                tile.addComponent<CAnimation>(m_game->assets().getAnimation(m_anim.question2), true, true);
             }
-            // collide from BELOW
-            else if (previousOverlap.x > 0 && playerTransform.prevPos.y > tileTransform.prevPos.y)
+            else if (tileType == m_anim.brick)
             {
-                playerTransform.pos.y += overlap.y;                                                                  // adjust position by overlap
-                playerTransform.velocity.y = 0;                                                                      // adjust velocity = 0
-                m_player->getComponent<CState>().jumpDuration = m_playerConfig.MAXJUMP;                              // stop current jump                   
-                
-                if (tileType == "Question")
-                {
-                    // Create a Coin tile one grid (64x64px) above the Question box position (tilePos), repeating = false
-                    auto coin = m_entityManager.addEntity("tile");
-                    auto tilePos = tile->getComponent<CTransform>().pos;
+                // No animation for Brick destruction when hit by player from below
+                tile.destroy();
+            }
+        }
+        
+        // collide from the LEFT
+        if (fromLeft) { playerTransform.pos.x -= overlap.x; }
 
-                    coin->addComponent<CAnimation>(m_game->assets().getAnimation("Coin"), false);
-                    coin->addComponent<CTransform>(Vec2(tilePos.x, tilePos.y - tile->getComponent<CBoundingBox>().size.y));
+        // collide from the RIGHT
+        else if (fromRight) { playerTransform.pos.x += overlap.x; }
+    }
 
-                    // Change Question box animation from blinking to steady. Won't trigger again because tileType is different
-                    tile->addComponent<CAnimation>(m_game->assets().getAnimation("Question2"), true);
-                }
-                else if (tileType == "Brick")
+    // Reset level if player has fallen below the screen (dies). Checked after tile collisions,
+    // which may stop a fast fall that ended below the screen
+    if (m_player.getComponent<CTransform>().pos.y + m_player.getComponent<CBoundingBox>().halfSize.y > height())
+    {
+        resetLevel();
+        m_coinPositions.clear();
+    }
+
+    // BULLETS & TILES
+    // Every bullet's hits are found in parallel against the tiles as they are now, then applied in
+    // order. A tile whose box an earlier bullet removed is skipped, it would not have been a candidate
+    auto& bullets = m_entityManager.getEntities(m_tag.bullet);
+    while (m_bulletHits.size() < bullets.size())
+    {
+        m_bulletHits.emplace_back();
+        m_bulletHits.back().reserve(4);
+    }
+    m_bulletPairTests.resize(bullets.size());
+
+    m_game->jobs().parallelFor(bullets.size(), BULLET_GRAIN, [&](size_t begin, size_t end)
+    {
+        auto& query = m_collisionQueries[m_game->jobs().threadIndex()];
+
+        for (size_t b = begin; b < end; b++)
+        {
+            auto& bullet = bullets[b];
+            m_bulletHits[b].clear();
+
+            queryTiles(bullet.getComponent<CTransform>(), bullet.getComponent<CBoundingBox>(), query);
+            Physics::getOverlaps(bullet.getComponent<CTransform>().pos, bullet.getComponent<CBoundingBox>().halfSize, query.boxes, query.overlaps);
+            m_bulletPairTests[b] = query.candidates.size();
+            bool fastBullet = isFastMover(bullet);
+
+            for (size_t i = 0; i < query.candidates.size(); i++)
+            {
+                // Fast bullets can step over a tile between frames, so also test the path they moved along
+                if (query.overlaps.hit(i) || (fastBullet && Physics::sweep(bullet, query.candidates[i]).hit))
                 {
-                    // No animation for Brick destruction when hit by player from below
-                    tile->destroy();
+                    m_bulletHits[b].push_back(query.candidates[i]);
                 }
             }
-            
-            // collide from the LEFT
-            if (previousOverlap.y > 0 && playerTransform.prevPos.x < tileTransform.prevPos.x) { playerTransform.pos.x -= overlap.x; }
+        }
+    });
 
-            // collide from the RIGHT
-            else if (previousOverlap.y > 0 && playerTransform.prevPos.x > tileTransform.prevPos.x) { playerTransform.pos.x += overlap.x; }
-        }    
+    for (size_t b = 0; b < bullets.size(); b++)
+    {
+        auto& bullet = bullets[b];
+        m_pairTests += m_bulletPairTests[b];
 
-        // BULLETS & TILES
-        for (auto& bullet : m_entityManager.getEntities("bullet"))
+        for (auto tile : m_bulletHits[b])
         {
-            Vec2 overlap          = Physics::getOverlap(bullet, tile);
+            if (!(tile.hasComponent<CBoundingBox>())) {continue;}
 
             // typedef for readability
-            auto& playerTransform = bullet->getComponent<CTransform>();
-            auto& tileTransform   = tile->getComponent<CTransform>();
-            auto& tileType = tile->getComponent<CAnimation>().animation.getName();
+            size_t tileType = tile.getComponent<CAnimation>().animation.getId();
 
-            if (Physics::isCollision(overlap))
+            bullet.destroy();
+            
+            if (tileType == m_anim.brick)
             {
-                bullet->destroy();
-                
-                if (tileType == "Brick")
-                {
-                    // Remove and replace Animation component. Explosion Animation set to repeating = false
-                    tile->removeComponent<CAnimation>();
-                    tile->addComponent<CAnimation>(m_game->assets().getAnimation("Explosion"), false);
-                
-                    // Remove BoundingBox component so player can move through tile even while Explosion Animation plays
-                    tile->removeComponent<CBoundingBox>();
-                }
+                // Remove and replace Animation component. Explosion Animation set to repeating = false
+                tile.removeComponent<CAnimation>();
+                tile.addComponent<CAnimation>(m_game->assets().getAnimation(m_anim.explosion), false);
+            
+                // Remove BoundingBox component so player can move through tile even while Explosion Animation plays
+                tile.removeComponent<CBoundingBox>();
             }
         }
     }
-    
-    // Movement and Collisions are done -> update prevPos
-    m_player->getComponent<CTransform>().prevPos = m_player->getComponent<CTransform>().pos;
+
+    // Coins from Question boxes hit this frame, repeating = false
+    for (auto& pos : m_coinPositions)
+    {
+        auto coin = m_entityManager.addEntity(m_tag.tile);
+        coin.addComponent<CAnimation>(m_game->assets().getAnimation(m_anim.coin), false);
+        coin.addComponent<CTransform>(pos);
+    }
+
+    // prevPos keeps the position before sMovement, the renderer interpolates from it
+    m_entityManager.updateSpatial(m_player);
 }
 
+// Fills query with the tiles whose collision boxes may overlap the box on its way from prevPos to pos:
+// grid sized tiles from the tilemap, all others from the broadphase, in slot order. Their boxes are
+// packed for Physics::getOverlaps. Only reads shared state, so threads can query at the same time
+void Scene_Play::queryTiles(const CTransform& transform, const CBoundingBox& box, CollisionQuery& query) const
+{
+    query.sweepPos      = (transform.pos + transform.prevPos) / 2.0f;
+    query.sweepHalfSize = Vec2(box.halfSize.x + fabsf(transform.pos.x - transform.prevPos.x) / 2.0f,
+                               box.halfSize.y + fabsf(transform.pos.y - transform.prevPos.y) / 2.0f);
+
+    auto& candidates = query.candidates;
+    m_entityManager.queryRegion(query.sweepPos, query.sweepHalfSize, m_tag.tile, candidates, query.slots);
+    m_tileMap.query(query.sweepPos, query.sweepHalfSize, candidates);
+
+    // Baked tiles whose collision box was removed stay in the static grid
+    auto noBox = std::remove_if(candidates.begin(), candidates.end(), [](const Entity& e) {return !e.hasComponent<CBoundingBox>();});
+    candidates.erase(noBox, candidates.end());
+    std::sort(candidates.begin(), candidates.end(), [](const Entity& a, const Entity& b) {return a.id() < b.id();});
+
+    query.boxes.clear();
+    for (auto& tile : candidates)
+    {
+        query.boxes.add(tile.getComponent<CTransform>().pos, tile.getComponent<CBoundingBox>().halfSize);
+    }
+}
+
+// Moving more than half its size in one frame, an entity can end past a tile's center or skip over
+// it entirely, so the overlap at pos alone is not enough to resolve its collisions
+bool Scene_Play::isFastMover(const Entity& e) const
+{
+    auto& transform = e.getComponent<CTransform>();
+    auto& box       = e.getComponent<CBoundingBox>();
+
+    return fabsf(transform.pos.x - transform.prevPos.x) > box.halfSize.x ||
+           fabsf(transform.pos.y - transform.prevPos.y) > box.halfSize.y;
+}
+
+// Counts lifespans down in parallel. Entities whose lifespan ran out are destroyed by sExpire,
+// once sCollision is done with them
 void Scene_Play::sLifespan()
 {
-    for (auto e : m_entityManager.getEntities())
+    auto& entities = m_entityManager.getDynamicEntities();
+    m_expiredFlags.assign(entities.size(), 0);
+
+    m_game->jobs().parallelFor(entities.size(), ENTITY_GRAIN, [&](size_t begin, size_t end)
     {
-        if (e->hasComponent<CLifespan>() && !m_paused)
+        for (size_t i = begin; i < end; i++)
         {
-            if (e->getComponent<CLifespan>().lifespan == 0) { e->destroy(); }
-            else { e->getComponent<CLifespan>().lifespan--; }
+            if (!entities[i].hasComponent<CLifespan>()) {continue;}
+
+            auto& lifespan = entities[i].getComponent<CLifespan>().lifespan;
+            if (lifespan == 0) { m_expiredFlags[i] = 1; }
+            else { lifespan--; }
         }
+    });
+
+    m_expired.clear();
+    for (size_t i = 0; i < entities.size(); i++)
+    {
+        if (m_expiredFlags[i]) {m_expired.push_back(entities[i]);}
     }
 }
 
+void Scene_Play::sExpire()
+{
+    // A level reset in sCollision may have dropped them already
+    for (auto& e : m_expired) {e.destroy();}
+}
+
 void Scene_Play::sAnimation()
 {
-    for (auto e : m_entityManager.getEntities())
+    // Player animations
+    if (m_player.hasComponent<CAnimation>())
     {
-        // Skip all entities without Animation component
-        if (!e->hasComponent<CAnimation>()) {continue;}
-
-        // Player animations
-        if (e == m_player)
+        // Get current animation, state, and direction player is facing (scale)
+        auto& playerAnimation = m_player.getComponent<CAnimation>().animation;
+        auto currentState = m_player.getComponent<CState>().state;
+        auto currentScale = m_player.getComponent<CTransform>().scale;
+        
+        // Select animation to match state without reloading same state
+        if (currentState == CState::STANDING && playerAnimation.getId() != m_anim.stand) 
         {
-            // Get current animation, state, and direction player is facing (scale)
-            auto& playerAnimation = m_player->getComponent<CAnimation>().animation;
-            std::string currentState = m_player->getComponent<CState>().state;
-            auto currentScale = m_player->getComponent<CTransform>().scale;
-            
-            // Select animation to match state without reloading same state
-            if (currentState == "standing" && playerAnimation.getName() != "Stand") 
-            {
-                playerAnimation = m_game->assets().getAnimation("Stand");
-            }
-            else if (currentState == "running" && playerAnimation.getName() != "Run")
-            {
-                playerAnimation = m_game->assets().getAnimation("Run");
-            }
-            else if (currentState == "air" && playerAnimation.getName() != "Air")
-            {
-                playerAnimation = m_game->assets().getAnimation("Air");
-            }
-
-            // Set player direction to previous player direction
-            m_player->getComponent<CTransform>().scale = currentScale;
+            playerAnimation = m_game->assets().getAnimation(m_anim.stand);
+        }
+        else if (currentState == CState::RUNNING && playerAnimation.getId() != m_anim.run)
+        {
+            playerAnimation = m_game->assets().getAnimation(m_anim.run);
+        }
+        else if (currentState == CState::AIR && playerAnimation.getId() != m_anim.air)
+        {
+            playerAnimation = m_game->assets().getAnimation(m_anim.air);
+        }
 
-            // Set check if in the air (jumping or falling)
-            if (m_player->getComponent<CTransform>().velocity.y != 0)
-            {
-                m_player->getComponent<CState>().state = "air";
-            }
+        // Set player direction to previous player direction
+        m_player.getComponent<CTransform>().scale = currentScale;
 
-            // Set direction player is facing and set running or standing
-            if ((m_player->getComponent<CInput>().left || m_player->getComponent<CInput>().right))
-            {
-                if (m_player->getComponent<CState>().state != "air")
-                {
-                    m_player->getComponent<CState>().state = "running";
-                }
+        // Set check if in the air (jumping or falling)
+        if (m_player.getComponent<CTransform>().velocity.y != 0)
+        {
+            m_player.getComponent<CState>().state = CState::AIR;
+        }
 
-                int left = m_player->getComponent<CInput>().left ? -1 : 1;
-                m_player->getComponent<CTransform>().scale.x = (fabsf(m_player->getComponent<CTransform>().scale.x) * left); 
-            }
-            else if (m_player->getComponent<CState>().state != "air")
+        // Set direction player is facing and set running or standing
+        if ((m_player.getComponent<CInput>().left || m_player.getComponent<CInput>().right))
+        {
+            if (m_player.getComponent<CState>().state != CState::AIR)
             {
-                m_player->getComponent<CState>().state = "standing";
+                m_player.getComponent<CState>().state = CState::RUNNING;
             }
+
+            int left = m_player.getComponent<CInput>().left ? -1 : 1;
+            m_player.getComponent<CTransform>().scale.x = (fabsf(m_player.getComponent<CTransform>().scale.x) * left); 
+        }
+        else if (m_player.getComponent<CState>().state != CState::AIR)
+        {
+            m_player.getComponent<CState>().state = CState::STANDING;
         }
+    }
 
-        // Update animation for ALL entities
-        auto& animation = e->getComponent<CAnimation>().animation;
-        animation.update();
+    // Clips shared by the level's tiles advance once for all of them
+    m_clock.update(m_currentFrame);
 
-        // Animation clean-up
-        if ((!e->getComponent<CAnimation>().repeating) && e->getComponent<CAnimation>().animation.hasEnded()) 
+    // Update animation for ALL other entities, each only touches its own. Off-screen ones advance
+    // too: when an effect ends decides when it is destroyed, so it must not depend on the view
+    auto& entities = m_entityManager.getEntities();
+    m_animationEnded.assign(entities.size(), 0);
+    m_game->jobs().parallelFor(entities.size(), ENTITY_GRAIN, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
         {
-            e->destroy();
+            // Skip all entities without Animation component, and those following the clock
+            if (!entities[i].hasComponent<CAnimation>()) {continue;}
+
+            auto& animation = entities[i].getComponent<CAnimation>();
+            if (animation.synced) {continue;}
+
+            animation.animation.update();
+            m_animationEnded[i] = !animation.repeating && animation.animation.hasEnded();
         }
+    });
+
+    // Animation clean-up, in order
+    for (size_t i = 0; i < entities.size(); i++)
+    {
+        if (m_animationEnded[i]) {entities[i].destroy();}
     }
 }
 
-void Scene_Play::sRender()
+void Scene_Play::sRender(RenderSnapshot& snapshot)
 {
+    // Rendering is added to the last simulated frame
+    ScopedTimer timer(m_profiler, SECTION_RENDER);
+
     // Clear the window to a blue
-    m_game->window().setView(m_game->window().getDefaultView());
-    m_game->window().clear(sf::Color(100, 100, 255));
+    snapshot.clearColor = sf::Color(100, 100, 255);
 
     // Horizontal scrolling
-    auto pPos = m_player->getComponent<CTransform>().pos;
-    float windowCenterX = fmax(m_game->window().getSize().x / 2.0f, pPos.x);
-    sf::View view = m_game->window().getView();
-    view.setCenter(windowCenterX, view.getCenter().y); //m_game->window().getSize().y - view.getCenter().y
-    m_game->window().setView(view);
+    snapshot.viewCenter = viewCenter();
+    snapshot.prevViewCenter = viewCenter(m_player.getComponent<CTransform>().prevPos);
+
+    // Only entities intersecting the view (plus margin) are drawn
+    queryVisibleEntities();
 
-    // Entity rendering and animation
+    // Entity rendering and animation, batched by the renderer into one draw call per texture
     if (m_drawTextures)
     {
-        for (auto e : m_entityManager.getEntities())
+        // The renderer keeps this order. Decorations and other tiles without collision (coins,
+        // explosions) go below solid tiles, the player above them and bullets on top. Entities of
+        // one layer stay in slot order, they do not overlap each other in practice
+        auto layer = [this](const Entity& e)
         {
-            auto& transform = e->getComponent<CTransform>();
+            if (e.tagId() == m_tag.bullet) {return 3;}
+            if (e.tagId() == m_tag.player) {return 2;}
+            return e.hasComponent<CBoundingBox>() ? 1 : 0;
+        };
+        std::stable_sort(m_visibleEntities.begin(), m_visibleEntities.end(), [&](const Entity& a, const Entity& b) {return layer(a) < layer(b);});
 
-            if (e->hasComponent<CAnimation>())
-            {
-                auto& animation = e->getComponent<CAnimation>().animation;
-                animation.getSprite().setRotation(transform.angle);
-                animation.getSprite().setPosition(transform.pos.x, transform.pos.y);
-                animation.getSprite().setScale(transform.scale.x, transform.scale.y);
-                m_game->window().draw(animation.getSprite());
-            }
-            //m_game->window().draw(e->getComponent<CAnimation>().animation.getSprite());
+        for (auto e : m_visibleEntities)
+        {
+            if (!e.hasComponent<CAnimation>()) {continue;}
+
+            auto& transform = e.getComponent<CTransform>();
+            auto& animation = e.getComponent<CAnimation>();
+            auto& rect = animation.synced ? m_clock.getTextureRect(animation.animation.getId()) : animation.animation.getTextureRect();
+            snapshot.sprites.push_back({e.id(), animation.animation.getTexture(), rect,
+                                        transform.prevPos, transform.pos, transform.scale, transform.angle});
         }
     }
+    m_profiler.setCounter(COUNTER_DRAW_CALLS, m_game->renderer().drawCalls());
 
     if (m_drawCollision)
     {
-        for (auto e : m_entityManager.getEntities())
+        for (auto e : m_visibleEntities)
         {
-            if (e->hasComponent<CBoundingBox>())
+            if (e.hasComponent<CBoundingBox>())
             {
-                auto& box = e->getComponent<CBoundingBox>();
-                auto& transform = e->getComponent<CTransform>();
-
-                sf::RectangleShape rect;
-                rect.setSize(sf::Vector2f(box.size.x-1, box.size.y-1));
-                rect.setOrigin(sf::Vector2f(box.halfSize.x, box.halfSize.y));
-                rect.setPosition(transform.pos.x, transform.pos.y);
-                rect.setFillColor(sf::Color(0,0,0,0));
-                rect.setOutlineColor(sf::Color(255,255,255,255));
-                rect.setOutlineThickness(1);
-                m_game->window().draw(rect);
+                auto& transform = e.getComponent<CTransform>();
+                snapshot.boxes.push_back({transform.prevPos, transform.pos, e.getComponent<CBoundingBox>().size});
             }
         }
     }
@@ -494,10 +759,64 @@ void Scene_Play::sRender()
     }
     */
 
-    m_game->window().display();
+    if (m_drawProfiler) {drawProfiler(snapshot);}
+}
+
+// Section times averaged over the last second, counters of the last frame, in the top-left corner
+void Scene_Play::drawProfiler(RenderSnapshot& snapshot)
+{
+    std::string text;
+    char line[128];
+
+    auto& sections = m_profiler.sectionNames();
+    for (size_t i = 0; i < sections.size(); i++)
+    {
+        snprintf(line, sizeof(line), "%-12s %7.3f ms\n", sections[i].c_str(), m_profiler.averageTime(i, 60));
+        text += line;
+    }
+
+    auto& counters = m_profiler.counterNames();
+    for (size_t i = 0; i < counters.size(); i++)
+    {
+        snprintf(line, sizeof(line), "%-12s %7zu\n", counters[i].c_str(), m_profiler.frame(0).counters[i]);
+        text += line;
+    }
+
+    auto textures = m_game->assets().textureStats();
+    snprintf(line, sizeof(line), "%-12s %7zu KB of %zu KB, %zu hits, %zu misses, %zu evictions\n", "textures",
+             textures.residentBytes / 1024, textures.budgetBytes / 1024, textures.hits, textures.misses, textures.evictions);
+    text += line;
+
+    snapshot.texts.push_back({text, &m_game->assets().getFont("Arial"), 12, sf::Color::White, Vec2(10, 10)});
+}
+
+// The view follows the player horizontally once past the first half screen.
+// Computed from the simulation state so headless runs cull exactly like rendered ones
+Vec2 Scene_Play::viewCenter()
+{
+    return viewCenter(m_player.getComponent<CTransform>().pos);
+}
+
+Vec2 Scene_Play::viewCenter(const Vec2& playerPos)
+{
+    return Vec2(fmax(width() / 2.0f, playerPos.x), height() / 2.0f);
+}
+
+void Scene_Play::queryVisibleEntities()
+{
+    float margin = m_game->cullMargin();
+    Vec2 halfSize(width() / 2.0f + margin, height() / 2.0f + margin);
+    m_entityManager.queryVisible(viewCenter(), halfSize, m_visibleEntities);
+}
+
+size_t Scene_Play::pairTests() const
+{
+    return m_pairTests;
 }
 
 void Scene_Play::onEnd()
 {
+    // The scene stays in the engine after the level ends, its textures may be unloaded
+    m_textures.clear();
     m_game->changeScene("MENU", std::make_shared<Scene_Menu>(m_game));
 }
\ No newline at end of file
@@ -8,54 +8,114 @@
 
 #include "EntityManager.h"
 #include "GameEngine.h"
+#include "JobSystem.h"
 #include "Physics.h"
+#include "LevelData.h"
+#include "Profiler.h"
+#include "TileMap.h"
 
 class Scene_Play : public Scene
 {
-    struct PlayerConfig
+protected:
+    enum Actions : uint8_t { PAUSE, QUIT, TOGGLE_TEXTURE, TOGGLE_COLLISION, TOGGLE_GRID, LEFT, RIGHT, JUMP, SHOOT, TOGGLE_PROFILER };
+
+    // Profiler ids, added in this order in init
+    enum ProfileSections : size_t { SECTION_ENTITIES, SECTION_MOVEMENT, SECTION_COLLISION, SECTION_LIFESPAN, SECTION_ANIMATION, SECTION_RENDER };
+    enum ProfileCounters : size_t { COUNTER_ENTITIES, COUNTER_PAIR_TESTS, COUNTER_DRAW_CALLS };
+
+    // Entities per job of the parallel systems
+    static const size_t ENTITY_GRAIN = 1024;
+    static const size_t BULLET_GRAIN = 16;
+
+    // Per thread buffers of a tile collision query
+    struct CollisionQuery
     {
-        float X, Y, CX, CY, SPEED, MAXSPEED, JUMP, MAXJUMP, GRAVITY;
-        std::string CHARACTER, WEAPON;
+        Vec2                sweepPos, sweepHalfSize;    // box around the movement that was queried
+        EntityVec           candidates;
+        std::vector<size_t> slots;
+        Physics::BoxBatch   boxes;                      // collision boxes of candidates, in the same order
+        Physics::Overlaps   overlaps;
     };
 
-    struct WeaponConfig
+    // Tag ids, resolved whenever the EntityManager is reset
+    struct TagIds
     {
-        float SPEED, LIFESPAN;
-        std::string WEAPON;
+        size_t tile, player, bullet;
     };
 
-protected:
-    std::shared_ptr<Entity> m_player;
+    // Animation ids used by the systems, resolved once per level
+    struct AnimationIds
+    {
+        size_t stand, run, air, character, weapon;
+        size_t question, question2, brick, explosion, coin;
+    };
+
+    Entity                  m_player;
     std::string             m_levelPath;
+    LevelData               m_levelData;            // parsed once per loadLevel
+    EntityManager           m_levelSnapshot;        // entity state right after spawnLevel, restored on death
     PlayerConfig            m_playerConfig;
     WeaponConfig            m_weaponConfig;
+    AnimationIds            m_anim;
+    TagIds                  m_tag;
+    bool                    m_levelLoaded = false;  // the level file could not be used if false, the scene returns to the menu
     bool                    m_drawTextures = true;
     bool                    m_drawCollision = false;
     bool                    m_drawGrid = false;
+    bool                    m_drawProfiler = false;
     const Vec2              m_gridSize = {64, 64};
     sf::Text                m_gridText;
+    Profiler                m_profiler;
+    EntityVec               m_visibleEntities;      // entities near the view, refreshed by queryVisibleEntities
+    TileMap                 m_tileMap;              // collision of the level's grid sized tiles
+    std::vector<TextureHandle> m_textures;          // keeps the textures of every animation the level can show resident
+    AnimationClock          m_clock;                // frames of the looping tile animations, shared by every tile
+    SystemScheduler         m_systems;              // systems of a step, see init
+    std::vector<CollisionQuery> m_collisionQueries; // indexed by JobSystem::threadIndex, reused every frame
+    Physics::Overlaps       m_previousOverlaps;     // player against its candidates
+    Physics::Overlaps       m_sweepOverlaps;
+    std::vector<EntityVec>  m_bulletHits;           // tiles hit by each bullet, found in parallel and applied in order
+    std::vector<size_t>     m_bulletPairTests;
+    std::vector<uint8_t>    m_expiredFlags;         // per dynamic entity, set by sLifespan's parallel countdown
+    EntityVec               m_expired;              // destroyed by sExpire
+    std::vector<uint8_t>    m_animationEnded;       // per entity, set by sAnimation's parallel update
+    std::vector<Vec2>       m_coinPositions;        // coins spawned after sCollision's loops, reused every frame
+    size_t                  m_pairTests = 0;        // narrowphase pair tests performed in the last sCollision
 
 
     void init(const std::string& levelPath);
-    void registerAction(sf::Keyboard::Key input, std::string actionName);
     
-    void loadLevel(const std::string& filename);
-    Vec2 gridToMidPixel(float gridX, float gridY, std::shared_ptr<Entity> entity);
+    bool loadLevel(const std::string& filename);
+    void spawnLevel();
+    void resetLevel();
+    Vec2 gridToMidPixel(float gridX, float gridY, const Entity& entity);
+
+    Vec2 viewCenter();
+    Vec2 viewCenter(const Vec2& playerPos);
+    void queryVisibleEntities();
 
     void spawnPlayer();
-    void spawnBullet();
+    Entity spawnBullet();
 
     void update();
+    void step();
     void sDoAction(const Action& action);
+    void sPlayerInput();
     void sMovement();
     void sCollision();
+    void queryTiles(const CTransform& transform, const CBoundingBox& box, CollisionQuery& query) const;
+    bool isFastMover(const Entity& e) const;
     void sLifespan();
+    void sExpire();
     void sAnimation();
-    void sRender();
+    void sRender(RenderSnapshot& snapshot);
+    void drawProfiler(RenderSnapshot& snapshot);
 
     void onEnd();
 
 public:
     Scene_Play(GameEngine* gameEngine, const std::string& levelPath);
 
+    size_t pairTests() const;
+
 };
\ No newline at end of file
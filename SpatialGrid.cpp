@@ -0,0 +1,121 @@
+#include "SpatialGrid.h"
+#include <algorithm>
+#include <cmath>
+
+SpatialGrid::SpatialGrid() {}
+
+SpatialGrid::SpatialGrid(const Vec2& cellSize)
+    : m_cellSize(cellSize)
+{}
+
+// An AABB covering [min, max) occupies cells floor(min / size) to ceil(max / size) - 1,
+// so boxes that only touch a cell edge are not stored in the neighbouring cell
+SpatialGrid::CellRange SpatialGrid::cellRange(const Vec2& pos, const Vec2& halfSize, const Vec2& cellSize)
+{
+    CellRange range;
+    range.minX = (int)std::floor((pos.x - halfSize.x) / cellSize.x);
+    range.minY = (int)std::floor((pos.y - halfSize.y) / cellSize.y);
+    range.maxX = std::max(range.minX, (int)std::ceil((pos.x + halfSize.x) / cellSize.x) - 1);
+    range.maxY = std::max(range.minY, (int)std::ceil((pos.y + halfSize.y) / cellSize.y) - 1);
+    return range;
+}
+
+// Packs the two cell coordinates, shifting unsigned because cells left of or above the origin are negative
+int64_t SpatialGrid::cellKey(int x, int y)
+{
+    return (int64_t)(((uint64_t)(uint32_t)x << 32) | (uint32_t)y);
+}
+
+void SpatialGrid::addToCells(size_t index, const CellRange& range)
+{
+    for (int x = range.minX; x <= range.maxX; x++)
+    {
+        for (int y = range.minY; y <= range.maxY; y++)
+        {
+            // New cells start with room for a few slots instead of growing one by one
+            auto& slots = m_cells[cellKey(x, y)];
+            if (slots.capacity() == 0) {slots.reserve(4);}
+            slots.push_back(index);
+        }
+    }
+}
+
+void SpatialGrid::removeFromCells(size_t index, const CellRange& range)
+{
+    for (int x = range.minX; x <= range.maxX; x++)
+    {
+        for (int y = range.minY; y <= range.maxY; y++)
+        {
+            auto cell = m_cells.find(cellKey(x, y));
+            if (cell == m_cells.end()) {continue;}
+
+            // swap-and-pop, order inside a cell does not matter because query() sorts
+            auto& slots = cell->second;
+            auto itr = std::find(slots.begin(), slots.end(), index);
+            if (itr != slots.end())
+            {
+                *itr = slots.back();
+                slots.pop_back();
+            }
+
+            // Cells left behind by moving entities would otherwise pile up over the whole level
+            if (slots.empty()) {m_cells.erase(cell);}
+        }
+    }
+}
+
+// Inserts the slot or moves it if its cell range has changed
+void SpatialGrid::insert(size_t index, const Vec2& pos, const Vec2& halfSize)
+{
+    if (index >= m_ranges.size()) {m_ranges.resize(index + 1);}
+
+    CellRange range = cellRange(pos, halfSize, m_cellSize);
+    if (range == m_ranges[index]) {return;}
+
+    removeFromCells(index, m_ranges[index]);
+    addToCells(index, range);
+    m_ranges[index] = range;
+}
+
+void SpatialGrid::remove(size_t index)
+{
+    if (!contains(index)) {return;}
+
+    removeFromCells(index, m_ranges[index]);
+    m_ranges[index] = CellRange();
+}
+
+void SpatialGrid::reserve(size_t slots)
+{
+    m_ranges.reserve(slots);
+}
+
+bool SpatialGrid::contains(size_t index) const
+{
+    return index < m_ranges.size() && !m_ranges[index].empty();
+}
+
+void SpatialGrid::query(const Vec2& pos, const Vec2& halfSize, std::vector<size_t>& out) const
+{
+    size_t first = out.size();
+    CellRange range = cellRange(pos, halfSize, m_cellSize);
+
+    for (int x = range.minX; x <= range.maxX; x++)
+    {
+        for (int y = range.minY; y <= range.maxY; y++)
+        {
+            auto cell = m_cells.find(cellKey(x, y));
+            if (cell != m_cells.end()) {out.insert(out.end(), cell->second.begin(), cell->second.end());}
+        }
+    }
+
+    // Slots spanning several cells are found once per cell. Results are sorted by slot index, not
+    // creation order since slots are recycled, but never depend on the order cells were filled in
+    std::sort(out.begin() + first, out.end());
+    out.erase(std::unique(out.begin() + first, out.end()), out.end());
+}
+
+const Vec2& SpatialGrid::cellSize() const
+{
+    return m_cellSize;
+}
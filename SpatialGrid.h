@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include "Vec2.h"
+
+// Uniform grid over the level used as a collision broadphase.
+// Each indexed slot is stored in every cell its AABB overlaps.
+class SpatialGrid
+{
+public:
+    // Cell mapping and keys, shared with StaticGrid so both grids agree on cells
+    struct CellRange
+    {
+        int minX = 0, minY = 0, maxX = -1, maxY = -1;
+
+        bool empty() const {return maxX < minX;}
+        bool operator == (const CellRange& rhs) const {return minX == rhs.minX && minY == rhs.minY && maxX == rhs.maxX && maxY == rhs.maxY;}
+    };
+
+    static CellRange    cellRange(const Vec2& pos, const Vec2& halfSize, const Vec2& cellSize);
+    static int64_t      cellKey(int x, int y);
+
+private:
+    Vec2                                                m_cellSize  = {64, 64};
+    std::unordered_map<int64_t, std::vector<size_t>>    m_cells;
+    std::vector<CellRange>                              m_ranges;       // cells currently occupied by each slot
+
+    void        addToCells(size_t index, const CellRange& range);
+    void        removeFromCells(size_t index, const CellRange& range);
+
+public:
+    SpatialGrid();
+    SpatialGrid(const Vec2& cellSize);
+
+    void insert(size_t index, const Vec2& pos, const Vec2& halfSize);
+    void remove(size_t index);
+    void reserve(size_t slots);
+    bool contains(size_t index) const;
+
+    // Appends the slots overlapping the AABB to out, sorted and without duplicates
+    void query(const Vec2& pos, const Vec2& halfSize, std::vector<size_t>& out) const;
+
+    const Vec2& cellSize() const;
+};
@@ -0,0 +1,71 @@
+#include "StaticGrid.h"
+#include <algorithm>
+
+StaticGrid::StaticGrid() {}
+
+void StaticGrid::build(const Vec2& cellSize, const std::vector<Item>& items)
+{
+    clear();
+    m_cellSize = cellSize;
+
+    // Every (cell, slot) pair, sorted by cell then slot, is grouped into runs per cell
+    std::vector<std::pair<int64_t, size_t>> entries;
+    for (auto& item : items)
+    {
+        auto range = SpatialGrid::cellRange(item.pos, item.halfSize, m_cellSize);
+        for (int x = range.minX; x <= range.maxX; x++)
+        {
+            for (int y = range.minY; y <= range.maxY; y++) {entries.push_back({SpatialGrid::cellKey(x, y), item.index});}
+        }
+    }
+    std::sort(entries.begin(), entries.end());
+
+    m_slots.reserve(entries.size());
+    for (auto& [key, index] : entries)
+    {
+        if (m_keys.empty() || m_keys.back() != key)
+        {
+            m_keys.push_back(key);
+            m_offsets.push_back((uint32_t)m_slots.size());
+        }
+        m_slots.push_back(index);
+    }
+    m_offsets.push_back((uint32_t)m_slots.size());
+}
+
+void StaticGrid::clear()
+{
+    m_keys.clear();
+    m_offsets.clear();
+    m_slots.clear();
+}
+
+void StaticGrid::query(const Vec2& pos, const Vec2& halfSize, std::vector<size_t>& out) const
+{
+    if (m_keys.empty()) {return;}
+
+    size_t first = out.size();
+    auto range = SpatialGrid::cellRange(pos, halfSize, m_cellSize);
+
+    for (int x = range.minX; x <= range.maxX; x++)
+    {
+        for (int y = range.minY; y <= range.maxY; y++)
+        {
+            int64_t cellKey = SpatialGrid::cellKey(x, y);
+            auto key = std::lower_bound(m_keys.begin(), m_keys.end(), cellKey);
+            if (key == m_keys.end() || *key != cellKey) {continue;}
+
+            size_t cell = key - m_keys.begin();
+            out.insert(out.end(), m_slots.begin() + m_offsets[cell], m_slots.begin() + m_offsets[cell + 1]);
+        }
+    }
+
+    // Slots spanning several cells are found once per cell
+    std::sort(out.begin() + first, out.end());
+    out.erase(std::unique(out.begin() + first, out.end()), out.end());
+}
+
+size_t StaticGrid::size() const
+{
+    return m_keys.size();
+}
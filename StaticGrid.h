@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "Vec2.h"
+#include "SpatialGrid.h"
+
+// Read-only uniform grid, built once from the AABBs of entities that never move. Cells are mapped
+// and keyed like SpatialGrid's.
+// Occupied cells are kept as sorted keys with offsets into one flat slot array, so a query
+// is a binary search per cell over contiguous memory and never allocates.
+class StaticGrid
+{
+public:
+    struct Item
+    {
+        size_t  index = 0;
+        Vec2    pos;
+        Vec2    halfSize;
+    };
+
+private:
+    Vec2                    m_cellSize = {64, 64};
+    std::vector<int64_t>    m_keys;         // occupied cells, sorted
+    std::vector<uint32_t>   m_offsets;      // slots of m_keys[i] are m_slots[m_offsets[i] .. m_offsets[i + 1])
+    std::vector<size_t>     m_slots;        // sorted within each cell
+
+public:
+    StaticGrid();
+
+    void build(const Vec2& cellSize, const std::vector<Item>& items);
+    void clear();
+
+    // Appends the slots whose cells overlap the AABB to out, sorted and without duplicates
+    void query(const Vec2& pos, const Vec2& halfSize, std::vector<size_t>& out) const;
+
+    size_t size() const;
+};
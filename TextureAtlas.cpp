@@ -0,0 +1,261 @@
+#include "TextureAtlas.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+TextureAtlas::TextureAtlas() {}
+
+void TextureAtlas::setPageSize(unsigned pageSize)
+{
+    m_pageSize = pageSize;
+}
+
+void TextureAtlas::clear()
+{
+    m_sources.clear();
+    m_pageSizes.clear();
+    m_pagePaths.clear();
+    m_pageImages.clear();
+    m_pages.clear();
+    m_regions.clear();
+}
+
+void TextureAtlas::addSource(const std::string& name, const std::string& path)
+{
+    Source source;
+    source.name = name;
+    source.path = path;
+    m_sources.push_back(std::move(source));
+}
+
+size_t TextureAtlas::sourceCount() const
+{
+    return m_sources.size();
+}
+
+bool TextureAtlas::decodeSource(size_t source)
+{
+    auto& s = m_sources[source];
+    s.decoded = s.image.loadFromFile(s.path);
+    return s.decoded;
+}
+
+// Shelf packing: images sorted by height fill rows left to right, a new row starts when one is full
+// and a new page when the rows reach the bottom
+void TextureAtlas::pack()
+{
+    std::vector<size_t> order(m_sources.size());
+    for (size_t i = 0; i < order.size(); i++) {order[i] = i;}
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b)
+    {
+        return m_sources[a].image.getSize().y > m_sources[b].image.getSize().y;
+    });
+
+    size_t   sharedPage = (size_t)-1;
+    unsigned x = 0, y = 0, shelfHeight = 0;
+
+    for (auto i : order)
+    {
+        auto size = m_sources[i].image.getSize();
+        unsigned w = size.x + 2 * m_padding;
+        unsigned h = size.y + 2 * m_padding;
+
+        Region region;
+
+        if (w > m_pageSize || h > m_pageSize)
+        {
+            // Too big to share a page, it keeps a page of its own
+            region.page = m_pageSizes.size();
+            region.rect = sf::IntRect(0, 0, size.x, size.y);
+            m_pageSizes.push_back(size);
+            m_regions[m_sources[i].name] = region;
+            continue;
+        }
+
+        if (x + w > m_pageSize) {x = 0; y += shelfHeight; shelfHeight = 0;}
+        if (sharedPage == (size_t)-1 || y + h > m_pageSize)
+        {
+            sharedPage = m_pageSizes.size();
+            m_pageSizes.push_back(sf::Vector2u(m_pageSize, m_pageSize));
+            x = 0; y = 0; shelfHeight = 0;
+        }
+
+        region.page = sharedPage;
+        region.rect = sf::IntRect(x + m_padding, y + m_padding, size.x, size.y);
+        m_regions[m_sources[i].name] = region;
+
+        x += w;
+        shelfHeight = std::max(shelfHeight, h);
+    }
+}
+
+void TextureAtlas::composePage(size_t page, sf::Image& pageImage) const
+{
+    pageImage.create(m_pageSizes[page].x, m_pageSizes[page].y, sf::Color::Transparent);
+
+    for (auto& source : m_sources)
+    {
+        auto& region = m_regions.at(source.name);
+        if (region.page != page) {continue;}
+
+        auto& r = region.rect;
+        auto  w = (int)source.image.getSize().x;
+        auto  h = (int)source.image.getSize().y;
+        pageImage.copy(source.image, r.left, r.top);
+
+        // Extrude the outermost rows and columns into the padding. Dedicated pages have no padding
+        if (r.left == 0 && r.top == 0) {continue;}
+        pageImage.copy(source.image, r.left, r.top - 1, sf::IntRect(0, 0, w, 1));
+        pageImage.copy(source.image, r.left, r.top + h, sf::IntRect(0, h - 1, w, 1));
+        pageImage.copy(source.image, r.left - 1, r.top, sf::IntRect(0, 0, 1, h));
+        pageImage.copy(source.image, r.left + w, r.top, sf::IntRect(w - 1, 0, 1, h));
+    }
+}
+
+void TextureAtlas::build(bool createTextures, const std::string& cachePath)
+{
+    m_sources.erase(std::remove_if(m_sources.begin(), m_sources.end(), [](const Source& s) {return !s.decoded;}), m_sources.end());
+    pack();
+
+    // Headless builds only need the regions, there is no page to upload or cache
+    bool saveCache = createTextures && !cachePath.empty();
+    std::ofstream index;
+    if (saveCache)
+    {
+        std::filesystem::path indexPath(cachePath + ".txt");
+        if (indexPath.has_parent_path()) {std::filesystem::create_directories(indexPath.parent_path());}
+        index.open(indexPath);
+    }
+
+    for (size_t page = 0; page < m_pageSizes.size(); page++)
+    {
+        m_pages.emplace_back();
+        if (!createTextures) {continue;}
+
+        m_pageImages.emplace_back();
+        m_pagePaths.emplace_back();
+        auto& pageImage = m_pageImages.back();
+        composePage(page, pageImage);
+
+        // A cached page can be decoded again after upload, otherwise its image is kept
+        if (saveCache)
+        {
+            std::string pagePath = cachePath + std::to_string(page) + ".png";
+            pageImage.saveToFile(pagePath);
+            index << "Page " << pagePath << "\n";
+            m_pagePaths.back() = pagePath;
+        }
+    }
+
+    for (auto& source : m_sources)
+    {
+        auto& region = m_regions.at(source.name);
+        if (saveCache)
+        {
+            index << "Texture " << source.name << " " << source.path << " " << region.page << " "
+                  << region.rect.left << " " << region.rect.top << " " << region.rect.width << " " << region.rect.height << "\n";
+        }
+    }
+
+    std::cout << "Packed " << m_sources.size() << " textures into " << m_pages.size() << " atlas pages" << std::endl;
+
+    // The decoded images now live in the page images
+    m_sources.clear();
+}
+
+bool TextureAtlas::loadCacheIndex(const std::string& cachePath, const std::vector<std::pair<std::string, std::string>>& sources, bool createTextures)
+{
+    namespace fs = std::filesystem;
+    std::string indexPath = cachePath + ".txt";
+
+    std::error_code error;
+    auto cacheTime = fs::last_write_time(indexPath, error);
+    if (error) {return false;}
+
+    for (auto& [name, path] : sources)
+    {
+        if (fs::last_write_time(path, error) > cacheTime || error) {return false;}
+    }
+
+    std::ifstream fin(indexPath);
+    std::string temp;
+    std::vector<std::string> pagePaths;
+    std::map<std::string, Region> regions;
+    size_t textures = 0;
+
+    while (fin >> temp)
+    {
+        if (temp == "Page")
+        {
+            std::string path;
+            fin >> path;
+            pagePaths.push_back(path);
+        }
+        else if (temp == "Texture")
+        {
+            std::string name, path;
+            Region region;
+            fin >> name >> path >> region.page >> region.rect.left >> region.rect.top >> region.rect.width >> region.rect.height;
+
+            // The texture list must be unchanged, in the same order
+            if (textures >= sources.size() || sources[textures].first != name || sources[textures].second != path) {return false;}
+            regions[name] = region;
+            textures++;
+        }
+    }
+    if (textures != sources.size()) {return false;}
+
+    m_pages = std::deque<sf::Texture>(pagePaths.size());
+    m_regions.swap(regions);
+    if (createTextures)
+    {
+        m_pagePaths.swap(pagePaths);
+        m_pageImages = std::vector<sf::Image>(m_pagePaths.size());
+    }
+    return true;
+}
+
+bool TextureAtlas::decodePage(size_t page)
+{
+    return m_pageImages[page].loadFromFile(m_pagePaths[page]);
+}
+
+bool TextureAtlas::hasPageImage(size_t page) const
+{
+    return page < m_pageImages.size() && m_pageImages[page].getSize().x > 0;
+}
+
+void TextureAtlas::uploadPage(size_t page, bool smooth)
+{
+    m_pages[page].loadFromImage(m_pageImages[page]);
+    m_pages[page].setSmooth(smooth);
+
+    if (!m_pagePaths[page].empty()) {m_pageImages[page] = sf::Image();}
+}
+
+// Assigning keeps the Texture's address, which Sprites point at
+void TextureAtlas::unloadPage(size_t page)
+{
+    m_pages[page] = sf::Texture();
+}
+
+bool TextureAtlas::hasRegion(const std::string& name) const
+{
+    return m_regions.find(name) != m_regions.end();
+}
+
+const TextureAtlas::Region& TextureAtlas::getRegion(const std::string& name) const
+{
+    return m_regions.at(name);
+}
+
+const sf::Texture& TextureAtlas::getPage(size_t page) const
+{
+    return m_pages[page];
+}
+
+size_t TextureAtlas::pageCount() const
+{
+    return m_pages.size();
+}
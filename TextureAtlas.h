@@ -0,0 +1,86 @@
+#pragma once
+
+#include <map>
+#include <deque>
+#include <string>
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+// Packs many small images into a few large atlas pages so sprites from different source images
+// share one texture. Images larger than a page get a page of their own.
+// The packed pages can be cached to disk and reloaded without decoding the source images.
+// Loading is split into stages so the slow ones can run on worker threads: decoding sources or
+// cached pages, then packing, all on the CPU. Pages become textures one at a time with uploadPage()
+// on the thread owning the GL context, and can be unloaded and uploaded again later.
+class TextureAtlas
+{
+public:
+    struct Region
+    {
+        size_t      page = 0;
+        sf::IntRect rect;           // where the source image sits inside the page
+    };
+
+private:
+    struct Source
+    {
+        std::string name;
+        std::string path;
+        sf::Image   image;
+        bool        decoded = false;
+    };
+
+    unsigned                        m_pageSize  = 2048;
+    unsigned                        m_padding   = 1;    // edge pixels are extruded into the padding against filtering bleed
+    std::vector<Source>             m_sources;          // images waiting for build()
+    std::vector<sf::Vector2u>       m_pageSizes;
+    std::vector<std::string>        m_pagePaths;        // cache file of each page, empty if it has none
+    std::vector<sf::Image>          m_pageImages;       // decoded pages waiting for uploadPage(), per page
+    std::deque<sf::Texture>         m_pages;            // deque so Sprites can keep pointers while pages are added
+    std::map<std::string, Region>   m_regions;
+
+    void pack();
+    void composePage(size_t page, sf::Image& pageImage) const;
+
+public:
+    TextureAtlas();
+
+    void setPageSize(unsigned pageSize);
+
+    // Drops all regions, pages and queued images
+    void clear();
+
+    // Queue an image for packing, it is read by decodeSource
+    void   addSource(const std::string& name, const std::string& path);
+    size_t sourceCount() const;
+
+    // Returns false if the image cannot be decoded. Different sources can be decoded concurrently
+    bool decodeSource(size_t source);
+
+    // Pack all decoded images, sources that failed to decode get no region. When createTextures is
+    // false (headless) only the regions are computed, otherwise the page images are composed for uploadPage().
+    // With a cachePath the pages are also written to <cachePath><page>.png with an index <cachePath>.txt
+    void build(bool createTextures, const std::string& cachePath = "");
+
+    // Reads the regions and pages of a cache written by build(). The cache is only used when it lists
+    // exactly the textures in sources (name, path), in order, and is newer than every source file.
+    // With createTextures the page images still have to be read by decodePage before uploadPage()
+    bool loadCacheIndex(const std::string& cachePath, const std::vector<std::pair<std::string, std::string>>& sources, bool createTextures);
+
+    // Returns false if the cached page cannot be decoded. Different pages can be decoded concurrently
+    bool decodePage(size_t page);
+
+    bool hasPageImage(size_t page) const;
+
+    // Creates the page's texture from its image, freeing the image if the page can be decoded again.
+    // Must run on a thread with an active GL context, as must unloadPage
+    void uploadPage(size_t page, bool smooth = true);
+
+    // Frees the page's texture. Sprites keep pointing at it and draw nothing until it is uploaded again
+    void unloadPage(size_t page);
+
+    bool                hasRegion(const std::string& name) const;
+    const Region&       getRegion(const std::string& name) const;
+    const sf::Texture&  getPage(size_t page) const;
+    size_t              pageCount() const;
+};
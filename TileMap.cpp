@@ -0,0 +1,58 @@
+#include "TileMap.h"
+#include <cmath>
+#include <algorithm>
+
+TileMap::TileMap() {}
+
+void TileMap::reset(const Vec2& cellSize, float height, int minX, int minY, int maxX, int maxY)
+{
+    m_cellSize  = cellSize;
+    m_height    = height;
+    m_minX      = minX;
+    m_minY      = minY;
+    m_columns   = std::max(0, maxX - minX + 1);
+    m_rows      = std::max(0, maxY - minY + 1);
+
+    m_cells.assign((size_t)m_columns * m_rows, Entity());
+}
+
+bool TileMap::set(int gridX, int gridY, const Entity& tile)
+{
+    int x = gridX - m_minX;
+    int y = gridY - m_minY;
+    if (x < 0 || y < 0 || x >= m_columns || y >= m_rows) {return false;}
+
+    auto& cell = m_cells[(size_t)y * m_columns + x];
+    if (cell.isActive()) {return false;}
+
+    cell = tile;
+    return true;
+}
+
+void TileMap::rebind(EntityManager& entities)
+{
+    for (auto& tile : m_cells) {tile = entities.rebind(tile);}
+}
+
+void TileMap::query(const Vec2& pos, const Vec2& halfSize, EntityVec& out) const
+{
+    // Pixel AABB [min, max) to grid cells, the grid's y axis points up from m_height
+    int minX = (int)std::floor((pos.x - halfSize.x) / m_cellSize.x);
+    int minY = (int)std::floor((m_height - (pos.y + halfSize.y)) / m_cellSize.y);
+    int maxX = std::max(minX, (int)std::ceil((pos.x + halfSize.x) / m_cellSize.x) - 1);
+    int maxY = std::max(minY, (int)std::ceil((m_height - (pos.y - halfSize.y)) / m_cellSize.y) - 1);
+
+    minX = std::max(minX - m_minX, 0);
+    minY = std::max(minY - m_minY, 0);
+    maxX = std::min(maxX - m_minX, m_columns - 1);
+    maxY = std::min(maxY - m_minY, m_rows - 1);
+
+    for (int y = minY; y <= maxY; y++)
+    {
+        for (int x = minX; x <= maxX; x++)
+        {
+            auto& tile = m_cells[(size_t)y * m_columns + x];
+            if (tile.isActive() && tile.hasComponent<CBoundingBox>()) {out.push_back(tile);}
+        }
+    }
+}
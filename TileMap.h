@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+#include "EntityManager.h"
+
+// Dense collision layer for level tiles that fill exactly one grid cell. Each cell holds the
+// tile's entity, so the tiles under an AABB are found with one array lookup per cell. A cell
+// stops colliding once its tile is destroyed or loses its CBoundingBox.
+//
+// Cells use level grid coordinates: x to the right and y up from the bottom of the window,
+// grid cell (x, y) covers pixels [x * w, (x + 1) * w) and (height - (y + 1) * h, height - y * h].
+class TileMap
+{
+    Vec2                m_cellSize  = {64, 64};
+    float               m_height    = 0;        // window height, grid row 0 sits on its bottom edge
+    int                 m_minX      = 0;
+    int                 m_minY      = 0;
+    int                 m_columns   = 0;
+    int                 m_rows      = 0;
+    std::vector<Entity> m_cells;                // row major, default Entity for empty cells
+
+public:
+    TileMap();
+
+    // Covers grid cells minX..maxX, minY..maxY and clears them
+    void reset(const Vec2& cellSize, float height, int minX, int minY, int maxX, int maxY);
+
+    // Puts the tile in its cell. Returns false, leaving the cell as it was, if the cell is outside
+    // the map or already holds a tile
+    bool set(int gridX, int gridY, const Entity& tile);
+
+    // Call after restoring the EntityManager to a snapshot taken once the tiles were set, so cells
+    // whose tile was destroyed and restored hold its new handle
+    void rebind(EntityManager& entities);
+
+    // Appends the colliding tiles in the cells the pixel AABB overlaps to out
+    void query(const Vec2& pos, const Vec2& halfSize, EntityVec& out) const;
+};
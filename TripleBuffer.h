@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Hands values from one producer thread to one consumer thread without locks or copies. The
+// producer fills back() and publishes it, the consumer picks up the latest published value and
+// reads it through front() for as long as it likes. Neither side ever waits for the other: values
+// the consumer was too slow to pick up are overwritten.
+template <typename T>
+class TripleBuffer
+{
+    static const uint8_t INDEX = 3;
+    static const uint8_t FRESH = 4;     // the middle buffer was published since the consumer last took it
+
+    T                       m_buffers[3];
+    uint8_t                 m_back = 0;         // owned by the producer
+    uint8_t                 m_front = 1;        // owned by the consumer
+    std::atomic<uint8_t>    m_middle = {2};     // index of the buffer in between, plus FRESH
+
+public:
+    // Producer side
+    T& back()
+    {
+        return m_buffers[m_back];
+    }
+
+    void publish()
+    {
+        m_back = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Consumer side. Returns false, keeping the current front, if nothing was published since
+    bool acquire()
+    {
+        if (!(m_middle.load(std::memory_order_relaxed) & FRESH)) {return false;}
+
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    const T& front() const
+    {
+        return m_buffers[m_front];
+    }
+};
@@ -1,7 +1,74 @@
 #include "GameEngine.h"
+#include "Scene_Play.h"
 
-int main()
+// Usage: MegaMario [--headless] [--level path] [--frames n] [--speed n] [--cull-margin px] [--threads n] [--texture-budget mb] [--profile csv] [--record log | --replay log]
+//   --headless   simulate without a window as fast as possible (starts bin/level1.txt unless --level is given)
+//   --level      skip the menu and play this level file
+//   --frames     stop after n engine frames (0 = until quit)
+//   --speed      simulation steps per engine frame
+//   --cull-margin  pixels around the view that are still rendered
+//   --threads    worker threads for the level's systems (0 = run them all on the main thread)
+//   --texture-budget  megabytes of textures kept loaded once no scene uses them
+//   --profile    write per-frame system timings and counters of the level to a CSV file
+//   --record     write the level's input and per-frame state hashes to a log
+//   --replay     replay a log headlessly and report the first frame whose state differs
+int main(int argc, char* argv[])
 {
-    GameEngine g = GameEngine("bin/assets.txt");
-    g.run();
-}
\ No newline at end of file
+    bool headless = false;
+    std::string level;
+    size_t frames = 0;
+    size_t speed = 1;
+    float cullMargin = 128;
+    long threads = -1;
+    long textureBudget = -1;
+    std::string profilePath;
+    std::string recordPath;
+    std::string replayPath;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+             if (arg == "--headless")                   { headless = true; }
+        else if (arg == "--level"  && i + 1 < argc)     { level = argv[++i]; }
+        else if (arg == "--frames" && i + 1 < argc)     { frames = std::stoul(argv[++i]); }
+        else if (arg == "--speed"  && i + 1 < argc)     { speed = std::stoul(argv[++i]); }
+        else if (arg == "--cull-margin" && i + 1 < argc){ cullMargin = std::stof(argv[++i]); }
+        else if (arg == "--threads" && i + 1 < argc)    { threads = std::stol(argv[++i]); }
+        else if (arg == "--texture-budget" && i + 1 < argc) { textureBudget = std::stol(argv[++i]); }
+        else if (arg == "--profile" && i + 1 < argc)    { profilePath = argv[++i]; }
+        else if (arg == "--record" && i + 1 < argc)     { recordPath = argv[++i]; }
+        else if (arg == "--replay" && i + 1 < argc)     { replayPath = argv[++i]; headless = true; }
+        else { std::cerr << "Unknown argument: " << arg << std::endl; return 1; }
+    }
+
+    // A replay always plays the level it was recorded on
+    InputLog log;
+    if (!replayPath.empty())
+    {
+        if (!log.load(replayPath)) { return 1; }
+        level = log.levelPath();
+    }
+
+    if ((headless || !recordPath.empty()) && level.empty()) { level = "bin/level1.txt"; }
+
+    GameEngine g = GameEngine("bin/assets.txt", headless);
+    g.setSimulationSpeed(speed);
+    g.setCullMargin(cullMargin);
+    g.setProfilePath(profilePath);
+    if (threads >= 0) { g.setWorkerThreads(threads); }
+    if (textureBudget >= 0) { g.setTextureBudget((size_t)textureBudget << 20); }
+
+    if (!level.empty())
+    {
+        g.waitForAssets();
+        g.changeScene("PLAY", std::make_shared<Scene_Play>(&g, level));
+    }
+
+    // Start logging only once the level scene is current
+    if (!recordPath.empty()) { g.startRecording(recordPath, level); }
+    if (!replayPath.empty()) { g.startReplay(std::move(log)); }
+
+    g.run(frames);
+
+    return g.divergedFrames() == 0 ? 0 : 2;
+}
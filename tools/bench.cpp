@@ -0,0 +1,185 @@
+#include "../GameEngine.h"
+#include "../Scene_Play.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <sstream>
+
+// Benchmark: generates synthetic levels in the text level format, plays each one headlessly
+// while spamming bullets, and reports the mean time per frame of every system and the number
+// of heap allocations per frame. Run from the repository root so bin/assets.txt is found.
+//
+// Usage: bench [--tiles 1000,10000,100000,1000000] [--bullets n] [--frames n] [--warmup n]
+//   --tiles    comma separated level sizes, in tiles
+//   --bullets  bullets spawned every frame
+//   --frames   measured frames per level
+//   --warmup   frames simulated before measuring
+
+static std::atomic<size_t> allocations(0);
+
+void* operator new(size_t size)
+{
+    allocations++;
+    if (void* p = std::malloc(size ? size : 1)) {return p;}
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept                  {std::free(p);}
+void operator delete(void* p, size_t) noexcept          {std::free(p);}
+void* operator new[](size_t size)                       {return operator new(size);}
+void operator delete[](void* p) noexcept                {std::free(p);}
+void operator delete[](void* p, size_t) noexcept        {std::free(p);}
+
+// Columns of ground with bricks, question boxes and decorations above, until tileCount is reached.
+// Level files store grid positions as 16 bit, so large levels stack extra blocks above the view
+static void writeLevel(const std::string& path, size_t tileCount)
+{
+    const size_t maxColumns = 30000;
+    size_t extraRows = (tileCount > 2 * maxColumns) ? (tileCount - 2 * maxColumns + maxColumns - 1) / maxColumns : 0;
+
+    std::ofstream fout(path);
+    size_t tiles = 0;
+    auto tile = [&](const char* type, const char* name, size_t x, size_t y)
+    {
+        if (tiles++ < tileCount) {fout << type << ' ' << name << ' ' << x << ' ' << y << '\n';}
+    };
+
+    for (size_t x = 0; tiles < tileCount; x++)
+    {
+        tile("Tile", "Ground", x, 0);
+        if (x % 4 == 1) {tile("Tile", "Brick",      x, 3);}
+        if (x % 4 == 3) {tile("Tile", "Question",   x, 3);}
+        if (x % 8 == 5) {tile("Tile", "Brick",      x, 6);}
+        if (x % 5 == 2) {tile("Dec",  "Bush",       x, 1);}
+        if (x % 6 == 0) {tile("Dec",  "CloudSmall", x, 8);}
+        for (size_t y = 0; y < extraRows; y++) {tile("Tile", "Block", x, 12 + y);}
+    }
+
+    fout << "Player  Stand 5 6 48 48 4 20 -10 20 1\n";
+    fout << "Weapon  Buster 10 45\n";
+}
+
+class BenchScene : public Scene_Play
+{
+public:
+    struct Result
+    {
+        double  frameNs = 0;
+        double  entitiesNs = 0, movementNs = 0, collisionNs = 0, lifespanNs = 0, animationNs = 0;
+        double  allocations = 0;
+        size_t  entities = 0;
+        double  pairTests = 0;
+    };
+
+    BenchScene(GameEngine* game, const std::string& levelPath)
+        : Scene_Play(game, levelPath)
+    {}
+
+    // Player runs right, bullets leave it at heights spread over the rows with bricks
+    void frame(size_t bullets)
+    {
+        m_player.getComponent<CInput>().right = true;
+
+        for (size_t i = 0; i < bullets; i++)
+        {
+            // Moved together with prevPos, so the first step is not taken for a fast vertical move
+            auto& transform = spawnBullet().getComponent<CTransform>();
+            transform.pos.y = transform.prevPos.y = height() - 64.0f * (1 + i % 8) - 32.0f;
+        }
+
+        simulate(1);
+    }
+
+    Result run(size_t frames, size_t warmup, size_t bullets)
+    {
+        // The level only reserves slots for one bullet per frame. Reserve the rest, and retake the
+        // snapshot the level respawns from, so warmup does not grow the pool
+        if (bullets > 1)
+        {
+            m_entityManager.reserve(m_tag.bullet, (bullets - 1) * ((size_t)m_weaponConfig.LIFESPAN + 1));
+            m_levelSnapshot = m_entityManager.snapshot();
+        }
+
+        for (size_t i = 0; i < warmup; i++) {frame(bullets);}
+
+        Result result;
+        for (size_t i = 0; i < frames; i++)
+        {
+            size_t allocationsBefore = allocations;
+            auto start = std::chrono::steady_clock::now();
+
+            frame(bullets);
+
+            auto end = std::chrono::steady_clock::now();
+            result.frameNs      += std::chrono::duration<double, std::nano>(end - start).count();
+            result.allocations  += allocations - allocationsBefore;
+
+            // Profiler sections are in milliseconds
+            auto& stats = m_profiler.frame(0);
+            result.entitiesNs   += stats.times[SECTION_ENTITIES]  * 1e6;
+            result.movementNs   += stats.times[SECTION_MOVEMENT]  * 1e6;
+            result.collisionNs  += stats.times[SECTION_COLLISION] * 1e6;
+            result.lifespanNs   += stats.times[SECTION_LIFESPAN]  * 1e6;
+            result.animationNs  += stats.times[SECTION_ANIMATION] * 1e6;
+            result.pairTests    += stats.counters[COUNTER_PAIR_TESTS];
+        }
+
+        for (auto value : {&result.frameNs, &result.entitiesNs, &result.movementNs, &result.collisionNs,
+                           &result.lifespanNs, &result.animationNs, &result.allocations, &result.pairTests})
+        {
+            *value /= frames;
+        }
+        result.entities = m_entityManager.getEntities().size();
+        return result;
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    std::vector<size_t> sizes = {1000, 10000, 100000, 1000000};
+    size_t bullets = 4;
+    size_t frames = 600;
+    size_t warmup = 60;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--tiles" && i + 1 < argc)
+        {
+            sizes.clear();
+            std::stringstream list(argv[++i]);
+            std::string size;
+            while (std::getline(list, size, ',')) {sizes.push_back(std::stoul(size));}
+        }
+        else if (arg == "--bullets" && i + 1 < argc)    { bullets = std::stoul(argv[++i]); }
+        else if (arg == "--frames"  && i + 1 < argc)    { frames = std::max((size_t)1, (size_t)std::stoul(argv[++i])); }
+        else if (arg == "--warmup"  && i + 1 < argc)    { warmup = std::stoul(argv[++i]); }
+        else { std::cerr << "Unknown argument: " << arg << std::endl; return 1; }
+    }
+
+    GameEngine game("bin/assets.txt", true);
+    std::filesystem::create_directories("bin/cache");
+
+    printf("\n%10s %9s %11s %11s %11s %11s %11s %11s %10s %12s\n", "tiles", "entities", "frame_ns", "entities_ns",
+           "movement_ns", "collide_ns", "lifespan_ns", "animate_ns", "pairs", "allocs/frame");
+
+    for (auto size : sizes)
+    {
+        std::string path = "bin/cache/bench_" + std::to_string(size) + ".txt";
+        writeLevel(path, size);
+
+        auto scene = std::make_shared<BenchScene>(&game, path);
+        game.changeScene("PLAY", scene);
+        auto r = scene->run(frames, warmup, bullets);
+
+        printf("%10zu %9zu %11.0f %11.0f %11.0f %11.0f %11.0f %11.0f %10.1f %12.2f\n", size, r.entities, r.frameNs,
+               r.entitiesNs, r.movementNs, r.collisionNs, r.lifespanNs, r.animationNs, r.pairTests, r.allocations);
+
+        // Release the level before generating the next one
+        game.changeScene("PLAY", nullptr);
+    }
+}
@@ -0,0 +1,20 @@
+#include "../LevelData.h"
+#include <iostream>
+
+// Level compiler: converts a text level (Tile/Dec/Player/Weapon lines) into the binary level format
+// Usage: levelc <level.txt> <level.mmlv>
+int main(int argc, char* argv[])
+{
+    if (argc != 3)
+    {
+        std::cerr << "Usage: levelc <level.txt> <level.mmlv>" << std::endl;
+        return 1;
+    }
+
+    LevelData level;
+    if (!level.loadText(argv[1]))   { return 1; }
+    if (!level.saveBinary(argv[2])) { return 1; }
+
+    std::cout << "Compiled " << argv[1] << ": " << level.tiles.size() << " tiles, "
+              << level.animations.size() << " animations -> " << argv[2] << std::endl;
+}
@@ -0,0 +1,260 @@
+#include "../GameEngine.h"
+#include "../Scene_Play.h"
+#include "../LevelData.h"
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+// Regression tests: each one writes a small level into bin/cache/, plays it headlessly and
+// checks where the entities end up. Run from the repository root so bin/assets.txt is found.
+// Prints every failed check and exits with 1 if there was any.
+//
+// Usage: tests
+
+static size_t failures = 0;
+
+#define CHECK(condition) check((condition), #condition, __FILE__, __LINE__)
+
+static void check(bool ok, const char* condition, const char* file, int line)
+{
+    if (ok) {return;}
+    printf("%s:%d: CHECK(%s) failed\n", file, line, condition);
+    failures++;
+}
+
+static bool near(float a, float b)
+{
+    return fabsf(a - b) < 0.01f;
+}
+
+static std::string writeLevel(const std::string& name, const std::string& contents)
+{
+    std::string path = "bin/cache/test_" + name + ".txt";
+    std::ofstream fout(path);
+    fout << contents;
+    return path;
+}
+
+// Scene_Play with its entities opened up to the tests
+class TestScene : public Scene_Play
+{
+public:
+    TestScene(GameEngine* game, const std::string& levelPath)
+        : Scene_Play(game, levelPath)
+    {}
+
+    Entity          player()    {return m_player;}
+    EntityVec       tiles()     {return m_entityManager.getEntities(m_tag.tile);}
+    CInput&         input()     {return m_player.getComponent<CInput>();}
+    EntityManager&  entities()  {return m_entityManager;}
+    size_t          tileTag()   {return m_tag.tile;}
+
+    Entity bullet()     {auto b = spawnBullet(); m_entityManager.update(); return b;}
+    void snapshot()     {m_levelSnapshot = m_entityManager.snapshot();}
+    void explode(Entity tile)
+    {
+        tile.addComponent<CAnimation>(m_game->assets().getAnimation(m_anim.explosion), false);
+        tile.removeComponent<CBoundingBox>();
+    }
+    void reset()        {resetLevel();}
+
+    // Teleports the player, as if it had been standing at pos since the last frame
+    void placePlayer(const Vec2& pos, const Vec2& velocity)
+    {
+        auto& transform = m_player.getComponent<CTransform>();
+        transform.pos       = pos;
+        transform.prevPos   = pos;
+        transform.velocity  = velocity;
+        m_entityManager.updateSpatial(m_player);
+    }
+
+    void step(size_t frames = 1)
+    {
+        simulate(frames);
+    }
+};
+
+// A fall of more than half a tile per frame that ends inside the tile, past its center,
+// lands on top of the tile instead of being pushed out below it
+static void testFastFallEndingInsideTile(GameEngine& game)
+{
+    auto level = writeLevel("fast_fall", "Tile Block 5 3\nPlayer Stand 2 8 48 48 4 20 -10 20 1\n");
+    auto scene = std::make_shared<TestScene>(&game, level);
+    game.changeScene("PLAY", scene);
+
+    Vec2 tile = scene->tiles()[0].getComponent<CTransform>().pos;
+    float extent = 24 + 32;
+
+    // Gravity adds 1, so the player moves 67 pixels and ends 10 below the tile's center
+    scene->placePlayer(Vec2(tile.x, tile.y - extent - 1), Vec2(0, 66));
+    scene->step();
+
+    auto& transform = scene->player().getComponent<CTransform>();
+    CHECK(near(transform.pos.y, tile.y - extent));
+    CHECK(transform.velocity.y == 0);
+    CHECK(scene->input().canJump);
+}
+
+// Running into a wall at more than half a tile per frame stops against the side it hit
+static void testFastRunEndingInsideTile(GameEngine& game)
+{
+    auto level = writeLevel("fast_run", "Tile Block 5 3\nPlayer Stand 2 8 48 48 100 20 -10 20 1\n");
+    auto scene = std::make_shared<TestScene>(&game, level);
+    game.changeScene("PLAY", scene);
+
+    Vec2 tile = scene->tiles()[0].getComponent<CTransform>().pos;
+    float extent = 24 + 32;
+
+    // Moves 100 pixels right and ends 43 right of the tile's center
+    scene->placePlayer(Vec2(tile.x - extent - 1, tile.y), Vec2(0, 0));
+    scene->input().right = true;
+    scene->step();
+
+    CHECK(near(scene->player().getComponent<CTransform>().pos.x, tile.x - extent));
+}
+
+// A handle to an entity created and destroyed after the snapshot stays invalid once restore()
+// has dropped its slot and the slot is reused
+static void testRestoreKeepsStaleHandlesInvalid(GameEngine& game)
+{
+    auto level = writeLevel("stale_handle", "Tile Block 5 3\nPlayer Stand 2 8 48 48 4 20 -10 20 1\n");
+    auto scene = std::make_shared<TestScene>(&game, level);
+    game.changeScene("PLAY", scene);
+
+    auto& entities = scene->entities();
+    auto stale = entities.addEntity(scene->tileTag());
+    entities.update();
+    stale.destroy();
+    entities.update();
+
+    scene->reset();
+    for (size_t i = 0; i < 16; i++) {entities.addEntity(scene->tileTag());}
+    entities.update();
+
+    CHECK(!stale.isActive());
+}
+
+// A tile destroyed after the snapshot collides again once restored
+static void testRestoredTileCollides(GameEngine& game)
+{
+    auto level = writeLevel("restored_tile", "Tile Brick 5 3\nPlayer Stand 2 8 48 48 4 20 -10 20 1\n");
+    auto scene = std::make_shared<TestScene>(&game, level);
+    game.changeScene("PLAY", scene);
+
+    auto brick = scene->tiles()[0];
+    Vec2 tile = brick.getComponent<CTransform>().pos;
+    brick.destroy();
+    scene->entities().update();
+
+    scene->reset();
+    CHECK(!brick.isActive());
+    CHECK(scene->tiles().size() == 1 && scene->tiles()[0].isActive());
+
+    scene->placePlayer(Vec2(tile.x, tile.y - 24 - 32 - 10), Vec2(0, 0));
+    scene->step(10);
+
+    CHECK(near(scene->player().getComponent<CTransform>().pos.y, tile.y - 24 - 32));
+}
+
+// Changes made only through getComponent references are undone for dynamic entities, and for
+// static ones marked with markModified
+static void testRestoreUndoesReferenceWrites(GameEngine& game)
+{
+    auto level = writeLevel("reference_writes", "Tile Block 5 3\nPlayer Stand 2 8 48 48 4 20 -10 20 1\n");
+    auto scene = std::make_shared<TestScene>(&game, level);
+    game.changeScene("PLAY", scene);
+
+    auto bullet = scene->bullet();
+    auto tile = scene->tiles()[0];
+    scene->snapshot();
+    int lifespan = bullet.getComponent<CLifespan>().lifespan;
+    Vec2 scale = tile.getComponent<CTransform>().scale;
+
+    bullet.getComponent<CLifespan>().lifespan = lifespan + 100;
+    tile.getComponent<CTransform>().scale = Vec2(-3, 3);
+    scene->entities().markModified(tile);
+
+    scene->reset();
+    CHECK(bullet.isActive() && bullet.getComponent<CLifespan>().lifespan == lifespan);
+    CHECK(tile.getComponent<CTransform>().scale == scale);
+}
+
+// An explosion far outside the view still ends and is destroyed, whatever the cull margin
+static void testOffscreenExplosionEnds(GameEngine& game)
+{
+    auto level = writeLevel("offscreen_explosion", "Tile Block 2 3\nTile Brick 60 3\nPlayer Stand 2 4 48 48 4 20 -10 20 1\n");
+    auto scene = std::make_shared<TestScene>(&game, level);
+    game.changeScene("PLAY", scene);
+    game.setCullMargin(0);
+
+    auto brick = scene->tiles()[1];
+    scene->explode(brick);
+    scene->step(300);
+
+    CHECK(!brick.isActive());
+    game.setCullMargin(128);
+}
+
+// Two tiles in one grid cell both collide, whichever of them is destroyed first
+static void testTilesSharingACell(GameEngine& game)
+{
+    auto level = writeLevel("shared_cell", "Tile Block 5 3\nTile Brick 5 3\nPlayer Stand 2 8 48 48 4 20 -10 20 1\n");
+
+    for (size_t destroyed = 0; destroyed < 2; destroyed++)
+    {
+        auto scene = std::make_shared<TestScene>(&game, level);
+        game.changeScene("PLAY", scene);
+
+        auto tiles = scene->tiles();
+        Vec2 tile = tiles[0].getComponent<CTransform>().pos;
+        tiles[destroyed].destroy();
+        scene->entities().update();
+
+        scene->placePlayer(Vec2(tile.x, tile.y - 24 - 32 - 10), Vec2(0, 0));
+        scene->step(10);
+
+        CHECK(near(scene->player().getComponent<CTransform>().pos.y, tile.y - 24 - 32));
+    }
+}
+
+// Fractional grid positions load from text and survive a compile, names the binary layout cannot
+// hold fail instead of being truncated
+static void testCompiledLevelPositionsAndNames()
+{
+    LevelData level;
+    CHECK(level.loadText(writeLevel("fractional", "Tile Block 5.5 3.25\nPlayer Stand 2 8 48 48 4 20 -10 20 1\n")));
+
+    std::string path = "bin/cache/test_fractional.mmlv";
+    CHECK(level.saveBinary(path));
+    LevelData compiled;
+    CHECK(compiled.load(path) && compiled.tiles.size() == 1);
+    CHECK(compiled.tiles[0].gridX == 5.5f && compiled.tiles[0].gridY == 3.25f);
+
+    std::filesystem::remove(path);
+    level.animations[0] = std::string(256, 'x');
+    CHECK(!level.saveBinary(path));
+    CHECK(!std::filesystem::exists(path));
+}
+
+int main()
+{
+    GameEngine game("bin/assets.txt", true);
+    game.waitForAssets();
+    std::filesystem::create_directories("bin/cache");
+
+    testFastFallEndingInsideTile(game);
+    testFastRunEndingInsideTile(game);
+    testRestoreKeepsStaleHandlesInvalid(game);
+    testRestoredTileCollides(game);
+    testRestoreUndoesReferenceWrites(game);
+    testOffscreenExplosionEnds(game);
+    testCompiledLevelPositionsAndNames();
+    testTilesSharingACell(game);
+
+    game.changeScene("PLAY", nullptr);
+
+    if (failures > 0) {printf("%zu checks failed\n", failures); return 1;}
+    printf("All tests passed\n");
+    return 0;
+}